@@ -1,5 +1,7 @@
 #include "mainwindow.h"
 
+#include "../qrypto/qryptocalibration.h"
+
 #include <QApplication>
 #include <QDir>
 #include <QLibraryInfo>
@@ -30,6 +32,8 @@ int main(int argc, char *argv[])
         break;
     }
 
+    Qrypto::KeyCalibration::instance().start(); // once per host, saves use the rates
+
     MainWindow w;
     w.show();
 
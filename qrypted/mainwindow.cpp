@@ -1,6 +1,7 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 
+#include "../qrypto/qryptocalibration.h"
 #include "../qrypto/qryptocipher.h"
 #include "../qrypto/qryptocompress.h"
 #include "../qrypto/qryptokeymaker.h"
@@ -308,7 +309,7 @@ bool MainWindow::saveFile(const QString &fileName)
     Qrypto::SequreString pwd(password->text());
     Qrypto::SequreBytes data;
 
-    for (Qrypto::SequreString str; str->isEmpty(); str->toUtf8().swap(*data)) {
+    for (Qrypto::SequreString str; str->isEmpty(); data = str->toUtf8()) {
         const QString rich(QLatin1String("html htm xsi"));
 
         if (rich.split(' ').contains(fileInfo.suffix(), Qt::CaseInsensitive))
@@ -334,8 +335,8 @@ bool MainWindow::saveFile(const QString &fileName)
         qryptic.cipher().setOperationCode(ui->methodComboBox->currentText());
         qryptic.keyMaker().setAlgorithmName(ui->digestComboBox->currentText());
         // TODO: make the following user configurable
-        qryptic.keyMaker().setIterationTime(500);
         qryptic.keyMaker().setKeyBitSize(512);
+        Qrypto::KeyCalibration::instance().apply(qryptic.keyMaker(), 500);
         qryptic.compress().setAlgorithm(Qrypto::Compress::ZLib);
     } else {
         pwd.clear();
@@ -0,0 +1,16 @@
+QT += core
+QT -= gui
+
+CONFIG += console
+CONFIG -= app_bundle
+
+TARGET = qrypto-calibrate
+TEMPLATE = app
+DESTDIR = $$PWD/bin
+OBJECTS_DIR = $$PWD/build/qrypto-calibrate
+MOC_DIR = $$OBJECTS_DIR
+
+#include(qrypto/botan.pri)
+include(qrypto/cryptopp.pri)
+
+SOURCES   += $$PWD/qrypto-calibrate/main.cpp
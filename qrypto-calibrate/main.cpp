@@ -0,0 +1,42 @@
+#include "../qrypto/qryptocalibration.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QTextStream>
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    a.setApplicationName("Qrypted"); // shares the settings of Qrypted
+    a.setApplicationVersion("2019.0508");
+    a.setOrganizationDomain("qrypted.org");
+    a.setOrganizationName("Qrypted");
+
+    QCommandLineParser parser;
+    QCommandLineOption force(QStringList() << "f" << "force", "Measure every digest again.");
+    QCommandLineOption time(QStringList() << "t" << "time", "Derivation time of saves.", "milliseconds", "500");
+    parser.setApplicationDescription("Prints the PBKDF2 iteration rate of each digest, measured once per host.");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addOption(force);
+    parser.addOption(time);
+    parser.process(a);
+
+    Qrypto::KeyCalibration &calibration = Qrypto::KeyCalibration::instance();
+    const uint milliseconds = parser.value(time).toUInt();
+    QTextStream out(stdout);
+
+    calibration.calibrate(parser.isSet(force));
+    out << left << qSetFieldWidth(12) << "Digest" << qSetFieldWidth(16) << "Iterations/s"
+        << qSetFieldWidth(0) << "Iterations of a 512 bit key in " << milliseconds << " ms" << endl;
+
+    for (int algorithm = 0; algorithm < Qrypto::KeyMaker::UnknownAlgorithm; ++algorithm) {
+        const Qrypto::KeyMaker keyMaker(Qrypto::KeyMaker::Algorithm(algorithm), 64);
+
+        out << qSetFieldWidth(12) << keyMaker.algorithmName()
+            << qSetFieldWidth(16) << calibration.rate(keyMaker.algorithm())
+            << qSetFieldWidth(0) << calibration.iterationCount(keyMaker, milliseconds) << endl;
+    }
+
+    return 0;
+}
@@ -2,6 +2,8 @@ include($$PWD/qrypto.pri)
 
 LIBS += -lcryptopp
 
+HEADERS += $$PWD/cryptopp/qryptofilter.h
+
 SOURCES += $$PWD/cryptopp/qryptocipher.cpp \
            $$PWD/cryptopp/qryptocompress.cpp \
            $$PWD/cryptopp/qryptokeymaker.cpp
@@ -2,8 +2,14 @@
 
 #include "../qryptokeymaker.h"
 #include "../sequre.h"
+#include "qryptofilter.h"
 
 #include <QScopedPointer>
+#include <QThread>
+#include <QVector>
+#include <QtConcurrentMap>
+
+#include "../pointerator.h"
 
 #include <cryptopp/camellia.h>
 #include <cryptopp/cast.h>
@@ -15,6 +21,7 @@
 #include <cryptopp/filters.h>
 #include <cryptopp/gcm.h>
 #include <cryptopp/idea.h>
+#include <cryptopp/misc.h>
 #include <cryptopp/modes.h>
 #include <cryptopp/osrng.h>
 #include <cryptopp/rijndael.h>
@@ -24,45 +31,168 @@
 #include <cryptopp/twofish.h>
 
 #include <ctime>
+#include <limits>
 
 namespace Qrypto
 {
 
 typedef CryptoPP::StringSinkTemplate<SequreBytes> SequreSink;
 
+typedef AppendSink<QByteArray> ArraySink;
+
+/// chunks authenticated and crypted in turn, small enough to stay in the L1 cache
+static const int FusedChunk = 16384;
+
+/// bytes of a batch of segments or slices, two of them must fit in a QByteArray
+static const qint64 MaxBatchSize = std::numeric_limits<int>::max() / 4;
+
+/**
+ * @brief The CipherSink class streams through a cipher
+ * @note non-authenticated operations are authenticated with HMAC of the plain stream
+ */
+class CipherSink : public FilterSink
+{
+    Cipher *m_q;
+    QScopedPointer<CryptoPP::Algorithm> m_cipher;
+    QScopedPointer<Sink> m_hmac;
+    QScopedPointer<Sink> m_tee;
+    QByteArray m_code;
+    bool m_decryption;
+    bool m_verification;
+
+public:
+    CipherSink(Cipher *q, CryptoPP::Algorithm *cipher) :
+        FilterSink(),
+        m_q(q),
+        m_cipher(cipher),
+        m_decryption(false),
+        m_verification(false)
+    { }
+
+    ~CipherSink()
+    { m_filter.reset(); } // the filters refer to the cipher
+
+    void decrypt(Sink *sink, const KeyMaker &keyMaker)
+    {
+        using namespace CryptoPP;
+        StreamTransformation *stream = dynamic_cast<StreamTransformation*>(m_cipher.data());
+        AuthenticatedSymmetricCipher *authentic = dynamic_cast<AuthenticatedSymmetricCipher*>(stream);
+        m_decryption = true;
+
+        if (authentic) {
+            m_filter.reset(new AuthenticatedDecryptionFilter(*authentic, new ForwardSink(sink)));
+        } else {
+            m_verification = !m_q->authentication().isEmpty();
+
+            if (m_verification)
+                m_hmac.reset(keyMaker.authenticator(m_code));
+
+            if (m_hmac) {
+                m_tee.reset(new TeeSink(m_hmac.data(), sink));
+                sink = m_tee.data();
+            }
+
+            m_filter.reset(new StreamTransformationFilter(*stream, new ForwardSink(sink)));
+        }
+    }
+
+    void encrypt(Sink *sink, const KeyMaker &keyMaker)
+    {
+        using namespace CryptoPP;
+        StreamTransformation *stream = dynamic_cast<StreamTransformation*>(m_cipher.data());
+        AuthenticatedSymmetricCipher *authentic = dynamic_cast<AuthenticatedSymmetricCipher*>(stream);
+        m_q->setAuthentication(QByteArray());
+
+        if (authentic) {
+            m_filter.reset(new AuthenticatedEncryptionFilter(*authentic, new ForwardSink(sink)));
+        } else {
+            m_hmac.reset(keyMaker.authenticator(m_code));
+            m_filter.reset(new StreamTransformationFilter(*stream, new ForwardSink(sink)));
+        }
+    }
+
+    Error write(const char *data, qint64 size)
+    {
+        if (!m_hmac)
+            return put(data, size, false);
+
+        Error error = NoError;
+
+        for (Pointerator<const char> it(data, size), chunk; !it.atEnd() && !error; ) {
+            chunk = it.read(FusedChunk);
+
+            if (!m_decryption)
+                m_hmac->write(chunk.data(), chunk.size());
+
+            error = put(chunk.data(), chunk.size(), false); // decrypted chunks reach the HMAC through the tee
+        }
+
+        return error;
+    }
+
+    Error close()
+    {
+        if (m_hmac && !m_decryption) {
+            m_hmac->close(); // the trailer may be written as soon as the next sink closes
+            m_q->setAuthentication(m_code);
+        }
+
+        const Error error = put(0, 0, true);
+
+        if (!error && m_verification && m_code != m_q->authentication())
+            return m_error = IntegrityError;
+
+        return error;
+    }
+};
+
 struct Cipher::Impl
 {
     Cipher *q;
 
     Impl(Cipher *q = 0) : q(q) { }
 
-    Qrypto::Error decrypt(CryptoPP::Algorithm *cipher, SequreBytes &dst, const QByteArray &src, const KeyMaker &keyMaker)
+    Qrypto::Error decrypt(CryptoPP::Algorithm *cipher, SequreBytes &dst, const char *src, int size, const KeyMaker &keyMaker)
     {
         using namespace CryptoPP;
         SimpleKeyingInterface *keying = dynamic_cast<SimpleKeyingInterface*>(cipher);
 
         if (keying->IsValidKeyLength(keyMaker.keyLength())) {
+            if (q->operation() == Cipher::STREAM)
+                return decryptSegments(dst, src, size, keyMaker);
+            else if (size >= 2 * SliceSize && isSliceable())
+                return decryptSlices(dst, src, size, keyMaker);
+
             QScopedPointer<SequreSink> sink(new SequreSink(dst));
             StreamTransformation *stream = dynamic_cast<StreamTransformation*>(cipher);
             AuthenticatedSymmetricCipher *authentic = dynamic_cast<AuthenticatedSymmetricCipher*>(stream);
-            dst.reserve(src.size());
+            KeyMaker::Hmac hmac;
+            dst.reserve(dst->size() + size);
 
-            if (keying->IVRequirement() == SimpleKeyingInterface::NOT_RESYNCHRONIZABLE) {
-                keying->SetKey(keyMaker.keyData(), keyMaker.keyLength());
-            } else {
-                keying->SetKeyWithIV(keyMaker.keyData(), keyMaker.keyLength(),
-                                     reinterpret_cast<const byte*>(q->m_initialVector.constData()),
-                                     q->m_initialVector.size());
-            }
+            setDecryptionKey(keying, keyMaker);
 
             if (authentic) {
-                StringSource(src.toStdString(), true,
+                StringSource(reinterpret_cast<const byte*>(src), size, true,
                              new AuthenticatedDecryptionFilter(*authentic, sink.take()));
-            } else {
-                StringSource(src.toStdString(), true,
+            } else if (q->m_authentication.isEmpty()) {
+                StringSource(reinterpret_cast<const byte*>(src), size, true,
                              new StreamTransformationFilter(*stream, sink.take()));
+            } else if (!hmac.init(keyMaker)) {
+                throw HashVerificationFilter::HashVerificationFailed();
+            } else {
+                StreamTransformationFilter filter(*stream, sink.take());
+                int from = dst->size();
 
-                if (!q->m_authentication.isEmpty() && keyMaker.authenticate(*dst) != q->m_authentication)
+                for (Pointerator<const char> it(src, size), chunk; !it.atEnd(); from = dst->size()) {
+                    chunk = it.read(FusedChunk);
+                    filter.Put(reinterpret_cast<const byte*>(chunk.data()), chunk.size());
+                    hmac.update(dst->constData() + from, dst->size() - from); // while the plain chunk is in cache
+                }
+
+                filter.MessageEnd();
+                hmac.update(dst->constData() + from, dst->size() - from);
+
+                if (hmac.final() != q->m_authentication)
                     throw HashVerificationFilter::HashVerificationFailed();
             }
 
@@ -72,46 +202,621 @@ struct Cipher::Impl
         }
     }
 
-    Qrypto::Error encrypt(CryptoPP::Algorithm *cipher, QByteArray &dst, const SequreBytes &src, const KeyMaker &keyMaker)
+    Qrypto::Error encrypt(CryptoPP::Algorithm *cipher, QByteArray &dst, const char *src, int size, const KeyMaker &keyMaker)
     {
         using namespace CryptoPP;
         SimpleKeyingInterface *keying = dynamic_cast<SimpleKeyingInterface*>(cipher);
 
         if (keying->IsValidKeyLength(keyMaker.keyLength())) {
-            std::string str;
-            QScopedPointer<StringSink> sink(new StringSink(str));
+            if (q->operation() == Cipher::STREAM)
+                return encryptSegments(dst, src, size, keyMaker);
+
+            QScopedPointer<ArraySink> sink(new ArraySink(dst));
             StreamTransformation *stream = dynamic_cast<StreamTransformation*>(cipher);
             AuthenticatedSymmetricCipher *authentic = dynamic_cast<AuthenticatedSymmetricCipher*>(stream);
-            str.reserve(src->size());
+            dst.resize(0);
+            dst.reserve(size + 32); // padding or tag
 
-            if (keying->IVRequirement() == SimpleKeyingInterface::NOT_RESYNCHRONIZABLE) {
-                q->m_initialVector.clear();
-                keying->SetKey(keyMaker.keyData(), keyMaker.keyLength());
-            } else {
-                AutoSeededRandomPool prng;
-                q->m_initialVector.resize(keying->IVSize());
-                keying->GetNextIV(prng, reinterpret_cast<byte*>(q->m_initialVector.data()));
-                keying->SetKeyWithIV(keyMaker.keyData(), keyMaker.keyLength(),
-                                     reinterpret_cast<byte*>(q->m_initialVector.data()));
-            }
+            setEncryptionKey(keying, keyMaker);
 
             if (authentic) {
-                StringSource(reinterpret_cast<const byte*>(src->constData()), src->size(), true,
+                StringSource(reinterpret_cast<const byte*>(src), size, true,
                              new AuthenticatedEncryptionFilter(*authentic, sink.take()));
                 q->m_authentication.clear();
             } else {
-                StringSource(reinterpret_cast<const byte*>(src->constData()), src->size(), true,
-                             new StreamTransformationFilter(*stream, sink.take()));
-                q->m_authentication = keyMaker.authenticate(*src);
+                StreamTransformationFilter filter(*stream, sink.take());
+                KeyMaker::Hmac hmac;
+                hmac.init(keyMaker);
+
+                for (Pointerator<const char> it(src, size), chunk; !it.atEnd(); ) {
+                    chunk = it.read(FusedChunk);
+                    hmac.update(chunk.data(), chunk.size()); // while the plain chunk is in cache
+                    filter.Put(reinterpret_cast<const byte*>(chunk.data()), chunk.size());
+                }
+
+                filter.MessageEnd();
+                q->m_authentication = hmac.final();
             }
 
-            QByteArray::fromStdString(str).swap(dst);
             return NoError;
         } else {
             throw InvalidKeyLength(cipher->AlgorithmName(), keyMaker.keyLength());
         }
     }
 
+    /**
+     * STREAM Operation splits plain data into segments of segmentSize,
+     * each one is GCM crypted with a nonce of initialVector prefix, big endian segment counter
+     * and last segment flag, followed by its tag
+     * @ref https://eprint.iacr.org/2015/189
+     */
+    static const int PrefixSize = 7;
+    static const int TagSize = 16;
+
+    /**
+     * @brief The Segment struct is a STREAM segment crypted by a thread of the pool
+     */
+    struct Segment
+    {
+        const char *src;
+        char *dst;
+        int size;
+        quint32 counter;
+        bool last;
+        Qrypto::Error error;
+    };
+
+    /**
+     * @brief The SegmentCrypt struct crypts a Segment with its own GCM instance
+     */
+    struct SegmentCrypt
+    {
+        typedef void result_type;
+        Cipher *q;
+        const KeyMaker *keyMaker;
+        bool encryption;
+
+        SegmentCrypt(Cipher *q, const KeyMaker &keyMaker, bool encryption) :
+            q(q),
+            keyMaker(&keyMaker),
+            encryption(encryption)
+        { }
+
+        void operator()(Segment &segment) const
+        {
+            using namespace CryptoPP;
+            Impl f(q);
+            byte nonce[PrefixSize + 5];
+            std::copy(q->m_initialVector.constData(), q->m_initialVector.constData() + PrefixSize, nonce);
+            nonce[PrefixSize] = byte(segment.counter >> 24);
+            nonce[PrefixSize + 1] = byte(segment.counter >> 16);
+            nonce[PrefixSize + 2] = byte(segment.counter >> 8);
+            nonce[PrefixSize + 3] = byte(segment.counter);
+            nonce[PrefixSize + 4] = segment.last ? 1 : 0;
+
+            try {
+                QScopedPointer<StreamTransformation> cipher(encryption ? f.newEncryption() : f.newDecryption());
+                AuthenticatedSymmetricCipher *authentic = dynamic_cast<AuthenticatedSymmetricCipher*>(cipher.data());
+                const byte *src = reinterpret_cast<const byte*>(segment.src);
+                byte *dst = reinterpret_cast<byte*>(segment.dst);
+                authentic->SetKeyWithIV(keyMaker->keyData(), keyMaker->keyLength(), nonce, sizeof nonce);
+
+                if (encryption) {
+                    authentic->EncryptAndAuthenticate(dst, dst + segment.size, TagSize, nonce, sizeof nonce,
+                                                      0, 0, src, segment.size);
+                } else if (!authentic->DecryptAndVerify(dst, src + segment.size - TagSize, TagSize, nonce, sizeof nonce,
+                                                        0, 0, src, segment.size - TagSize)) {
+                    segment.error = IntegrityError;
+                }
+            } catch (const std::bad_alloc &exc) {
+                segment.error = OutOfMemory;
+            } catch (const CryptoPP::Exception &exc) {
+                qCritical("%s", exc.what());
+                segment.error = toError(exc);
+            } catch (const std::exception &exc) {
+                qCritical("%s", exc.what());
+                segment.error = UnknownError;
+            }
+        }
+    };
+
+    /**
+     * @brief cryptedSize of STREAM segments
+     * @param size of segments to crypt
+     * @param last whether segments end with the last one
+     * @param encryption
+     * @return -1 if size is not valid for decryption
+     */
+    qint64 cryptedSize(qint64 size, bool last, bool encryption) const
+    {
+        const qint64 unit = q->m_segmentSize + (encryption ? 0 : TagSize);
+        const qint64 count = last ? qMax<qint64>(1, (size + unit - 1) / unit) : size / unit;
+
+        if (encryption)
+            return size + count * TagSize;
+        else if (count == 0 || size - (count - 1) * unit < TagSize)
+            return -1;
+        else
+            return size - count * TagSize;
+    }
+
+    /**
+     * @brief cryptSegments crypts whole STREAM segments in parallel
+     * @param dst of cryptedSize
+     * @param src
+     * @param size of src
+     * @param counter of the first segment
+     * @param last whether src ends with the last segment
+     * @param keyMaker
+     * @param encryption
+     * @return first segment error
+     */
+    Qrypto::Error cryptSegments(char *dst, const char *src, qint64 size, quint32 counter, bool last,
+                                const KeyMaker &keyMaker, bool encryption)
+    {
+        const qint64 unit = q->m_segmentSize + (encryption ? 0 : TagSize);
+        const qint64 step = q->m_segmentSize + (encryption ? TagSize : 0);
+        QVector<Segment> segments;
+        segments.reserve((size + unit - 1) / unit + 1);
+
+        for (qint64 i = 0, offset = 0; offset < size || (last && i == 0); ++i, offset += unit) {
+            Segment segment;
+            segment.src = src + offset;
+            segment.dst = dst + i * step;
+            segment.size = int(qMin(unit, size - offset));
+            segment.counter = counter + quint32(i);
+            segment.last = last && offset + unit >= size;
+            segment.error = NoError;
+            segments.append(segment);
+        }
+
+        QtConcurrent::blockingMap(segments, SegmentCrypt(q, keyMaker, encryption));
+
+        foreach (const Segment &segment, segments) {
+            if (segment.error)
+                return segment.error;
+        }
+
+        return NoError;
+    }
+
+    Qrypto::Error decryptSegments(SequreBytes &dst, const char *src, int size, const KeyMaker &keyMaker)
+    {
+        const qint64 plainSize = cryptedSize(size, true, false);
+        const int offset = dst->size();
+
+        if (plainSize < 0 || q->m_initialVector.size() != PrefixSize)
+            return InvalidFormat;
+
+        if (q->m_segmentCount && q->m_segmentCount != (size - plainSize) / TagSize)
+            return IntegrityError;
+
+        dst.resize(offset + int(plainSize));
+        return cryptSegments(dst->data() + offset, src, size, 0, true, keyMaker, false);
+    }
+
+    Qrypto::Error encryptSegments(QByteArray &dst, const char *src, int size, const KeyMaker &keyMaker)
+    {
+        const qint64 cryptSize = cryptedSize(size, true, true);
+
+        if (cryptSize > std::numeric_limits<int>::max())
+            return OutOfMemory;
+
+        newPrefix();
+        dst.resize(int(cryptSize));
+        q->m_authentication.clear();
+        q->m_segmentCount = quint32((cryptSize - size) / TagSize);
+        return cryptSegments(dst.data(), src, size, 0, true, keyMaker, true);
+    }
+
+    void newPrefix()
+    {
+        CryptoPP::AutoSeededRandomPool prng;
+        q->m_initialVector.resize(PrefixSize);
+        prng.GenerateBlock(reinterpret_cast<CryptoPP::byte*>(q->m_initialVector.data()), PrefixSize);
+    }
+
+    class SegmentSink;
+
+    class SliceSink;
+
+    /**
+     * Crypt data of CBC, CFB, CTR, ECB and GCM Operations can be decrypted in slices at block boundaries,
+     * each slice restarts from the previous crypt block or a seeked counter,
+     * GCM tag is combined from GHASH of each slice computed as GCM tag of additional authenticated data
+     */
+    static const int SliceSize = 1048576;
+
+    /**
+     * @brief The Ghash struct is an element of GF(2^128) in GCM bit order
+     * @note bitwise multiplication, only used to combine a few slice tags
+     */
+    struct Ghash
+    {
+        quint64 hi;
+        quint64 lo;
+
+        Ghash(quint64 hi = 0, quint64 lo = 0) :
+            hi(hi),
+            lo(lo)
+        { }
+
+        Ghash(const CryptoPP::byte *block) :
+            hi(0),
+            lo(0)
+        {
+            for (int i = 0; i < 8; ++i) {
+                hi = (hi << 8) | block[i];
+                lo = (lo << 8) | block[i + 8];
+            }
+        }
+
+        void toBlock(CryptoPP::byte *block) const
+        {
+            for (int i = 0; i < 8; ++i) {
+                block[i] = CryptoPP::byte(hi >> (56 - i * 8));
+                block[i + 8] = CryptoPP::byte(lo >> (56 - i * 8));
+            }
+        }
+
+        Ghash operator^(const Ghash &y) const
+        { return Ghash(hi ^ y.hi, lo ^ y.lo); }
+
+        Ghash operator*(const Ghash &y) const
+        {
+            Ghash z;
+            Ghash v(y);
+
+            for (int i = 0; i < 128; ++i) {
+                if ((i < 64 ? hi << i : lo << (i - 64)) & Q_UINT64_C(0x8000000000000000))
+                    z = z ^ v;
+
+                const bool carry = v.lo & 1;
+                v.lo = (v.lo >> 1) | (v.hi << 63);
+                v.hi = (v.hi >> 1) ^ (carry ? Q_UINT64_C(0xE100000000000000) : 0);
+            }
+
+            return z;
+        }
+
+        Ghash pow(quint64 n) const
+        {
+            Ghash x(*this);
+            Ghash y(Q_UINT64_C(0x8000000000000000)); // one
+
+            for (; n; n >>= 1, x = x * x) {
+                if (n & 1)
+                    y = y * x;
+            }
+
+            return y;
+        }
+    };
+
+    /**
+     * @brief The Slice struct is a part of crypt data decrypted by a thread of the pool
+     */
+    struct Slice
+    {
+        const char *src;
+        char *dst;
+        qint64 offset; ///< in the whole crypt data
+        int size;
+        CryptoPP::byte tag[TagSize];
+        Qrypto::Error error;
+    };
+
+    /**
+     * @brief The SliceDecrypt struct decrypts a Slice with its own cipher instance
+     */
+    struct SliceDecrypt
+    {
+        typedef void result_type;
+        Cipher *q;
+        Cipher *stream;
+        const KeyMaker *keyMaker;
+
+        SliceDecrypt(Cipher *q, Cipher *stream, const KeyMaker &keyMaker) :
+            q(q),
+            stream(stream),
+            keyMaker(&keyMaker)
+        { }
+
+        void operator()(Slice &slice) const
+        {
+            using namespace CryptoPP;
+            Impl f(stream);
+            const byte *src = reinterpret_cast<const byte*>(slice.src);
+            const byte *iv = reinterpret_cast<const byte*>(q->m_initialVector.constData());
+            byte *dst = reinterpret_cast<byte*>(slice.dst);
+
+            try {
+                QScopedPointer<StreamTransformation> cipher(f.newDecryption());
+                SimpleKeyingInterface *keying = dynamic_cast<SimpleKeyingInterface*>(cipher.data());
+                byte counter[TagSize] = { 0 };
+
+                switch (q->operation()) {
+                case Cipher::CBC:
+                case Cipher::CFB:
+                    if (slice.offset)
+                        keying->SetKeyWithIV(keyMaker->keyData(), keyMaker->keyLength(), src - keying->IVSize(), keying->IVSize());
+                    else
+                        keying->SetKeyWithIV(keyMaker->keyData(), keyMaker->keyLength(), iv, q->m_initialVector.size());
+
+                    break;
+                case Cipher::ECB:
+                    keying->SetKey(keyMaker->keyData(), keyMaker->keyLength());
+                    break;
+                case Cipher::GCM:
+                    std::copy(iv, iv + 12, counter);
+                    counter[TagSize - 1] = 2; // first counter after the tag mask
+                    keying->SetKeyWithIV(keyMaker->keyData(), keyMaker->keyLength(), counter, sizeof counter);
+                    cipher->Seek(slice.offset);
+                    break;
+                default:
+                    keying->SetKeyWithIV(keyMaker->keyData(), keyMaker->keyLength(), iv, q->m_initialVector.size());
+                    cipher->Seek(slice.offset);
+                }
+
+                cipher->ProcessData(dst, src, slice.size);
+
+                if (q->operation() == Cipher::GCM)
+                    Impl(q).authenticate(slice.tag, src, slice.size, *keyMaker);
+            } catch (const std::bad_alloc &exc) {
+                slice.error = OutOfMemory;
+            } catch (const CryptoPP::Exception &exc) {
+                qCritical("%s", exc.what());
+                slice.error = toError(exc);
+            } catch (const std::exception &exc) {
+                qCritical("%s", exc.what());
+                slice.error = UnknownError;
+            }
+        }
+    };
+
+    /**
+     * @brief isSliceable whether the Operation can be decrypted in slices on more than one thread
+     */
+    bool isSliceable() const
+    {
+        switch (q->operation()) {
+        case Cipher::GCM:
+            if (q->m_initialVector.size() != 12)
+                return false;
+            /* FALLTHRU */
+        case Cipher::CBC:
+        case Cipher::CFB:
+        case Cipher::CTR:
+        case Cipher::ECB:
+            return QThread::idealThreadCount() > 1;
+        default:
+            return false;
+        }
+    }
+
+    /**
+     * @brief authenticate computes GCM tag of additional authenticated data without any message
+     */
+    void authenticate(CryptoPP::byte *tag, const CryptoPP::byte *aad, int size, const KeyMaker &keyMaker)
+    {
+        QScopedPointer<CryptoPP::StreamTransformation> cipher(newEncryption());
+        CryptoPP::AuthenticatedSymmetricCipher *gcm = dynamic_cast<CryptoPP::AuthenticatedSymmetricCipher*>(cipher.data());
+        const CryptoPP::byte *iv = reinterpret_cast<const CryptoPP::byte*>(q->m_initialVector.constData());
+        CryptoPP::byte none = 0;
+        gcm->SetKeyWithIV(keyMaker.keyData(), keyMaker.keyLength(), iv, q->m_initialVector.size());
+        gcm->EncryptAndAuthenticate(&none, tag, TagSize, iv, q->m_initialVector.size(), size ? aad : &none, size, &none, 0);
+    }
+
+    /**
+     * @brief verifySlices combines GCM tags of slices into the tag of the whole crypt data
+     * @ref https://nvlpubs.nist.gov/nistpubs/Legacy/SP/nistspecialpublication800-38d.pdf
+     */
+    bool verifySlices(const QVector<Slice> &slices, const char *tag, qint64 size, const KeyMaker &keyMaker)
+    {
+        using namespace CryptoPP;
+        Cipher ecb(*q);
+        ecb.setOperation(Cipher::ECB);
+        QScopedPointer<StreamTransformation> block(Impl(&ecb).newEncryption());
+        byte zero[TagSize] = { 0 };
+        byte mask[TagSize];
+        byte hash[TagSize];
+        dynamic_cast<SimpleKeyingInterface*>(block.data())->SetKey(keyMaker.keyData(), keyMaker.keyLength());
+        block->ProcessData(hash, zero, TagSize);
+        authenticate(mask, zero, 0, keyMaker); // tag of nothing is the encrypted initial counter
+
+        // S = L * H + sum (T_k + E(J0) + L_k * H) * H^(blocks after slice k)
+        const Ghash h(hash);
+        const Ghash e(mask);
+        Ghash s = Ghash(0, quint64(size) * 8) * h;
+        quint64 after = 0;
+
+        for (int k = slices.size(); k-- > 0; ) {
+            const Slice &slice = slices.at(k);
+            s = s ^ (Ghash(slice.tag) ^ e ^ Ghash(quint64(slice.size) * 8, 0) * h) * h.pow(after);
+            after += (slice.size + TagSize - 1) / TagSize;
+        }
+
+        (s ^ e).toBlock(hash);
+        return VerifyBufsEqual(hash, reinterpret_cast<const byte*>(tag), TagSize);
+    }
+
+    /**
+     * @brief decryptSlices decrypts crypt data in slices of a thread each
+     * @param slices receives the slices with their GCM tags
+     * @param dst of size
+     * @param src preceded by the previous crypt block, unless offset is 0
+     * @param offset of src in the whole crypt data
+     * @param stream cipher of the slices, CTR for the GCM keystream
+     * @return first slice error
+     */
+    Qrypto::Error decryptSlices(QVector<Slice> &slices, char *dst, const char *src, qint64 size, qint64 offset,
+                                Cipher *stream, const KeyMaker &keyMaker)
+    {
+        const qint64 count = qBound<qint64>(1, size / SliceSize, qMax(QThread::idealThreadCount(), 1));
+        const qint64 sliceSize = ((size + count - 1) / count + TagSize - 1) / TagSize * TagSize;
+        slices.resize(0);
+
+        for (Pointerator<const char> it(src, size); !it.atEnd(); ) {
+            const Pointerator<const char> chunk(it.read(size_t(sliceSize)));
+            Slice slice;
+            slice.src = chunk.data();
+            slice.dst = dst + (chunk.data() - src);
+            slice.offset = offset + (chunk.data() - src);
+            slice.size = int(chunk.size());
+            slice.error = NoError;
+            slices.append(slice);
+        }
+
+        QtConcurrent::blockingMap(slices, SliceDecrypt(q, stream, keyMaker));
+
+        foreach (const Slice &slice, slices) {
+            if (slice.error)
+                return slice.error;
+        }
+
+        return NoError;
+    }
+
+    /**
+     * @brief paddingSize of the last CBC or ECB block, PKCS #7
+     * @param plain ending with the last block
+     * @return -1 if not valid
+     */
+    static int paddingSize(const char *plain, int size, int blockSize)
+    {
+        const int padding = size > 0 ? uchar(plain[size - 1]) : 0;
+
+        if (padding == 0 || padding > blockSize || padding > size ||
+                std::count(plain + size - padding, plain + size, char(padding)) != padding)
+            return -1;
+
+        return padding;
+    }
+
+    Qrypto::Error decryptSlices(SequreBytes &dst, const char *src, int size, const KeyMaker &keyMaker)
+    {
+        using namespace CryptoPP;
+        const bool gcm = q->operation() == Cipher::GCM;
+        const int cryptSize = gcm ? size - TagSize : size;
+        const int offset = dst->size();
+        QScopedPointer<StreamTransformation> probe(newDecryption());
+        const int blockSize = probe->MandatoryBlockSize();
+        Cipher stream(*q);
+        QVector<Slice> slices;
+
+        if (cryptSize % blockSize)
+            throw InvalidCiphertext("StreamTransformationFilter: ciphertext length is not a multiple of block size");
+
+        if (gcm)
+            stream.setOperation(Cipher::CTR); // GCM keystream
+
+        dst.resize(offset + cryptSize);
+
+        if (const Qrypto::Error error = decryptSlices(slices, dst->data() + offset, src, cryptSize, 0, &stream, keyMaker)) {
+            dst.resize(offset);
+            return error;
+        }
+
+        if (gcm && !verifySlices(slices, src + cryptSize, cryptSize, keyMaker)) {
+            dst.resize(offset);
+            throw HashVerificationFilter::HashVerificationFailed();
+        }
+
+        if (q->operation() == Cipher::CBC || q->operation() == Cipher::ECB) {
+            const int padding = paddingSize(dst->constData() + offset, cryptSize, blockSize);
+
+            if (padding < 0) {
+                dst.resize(offset);
+                throw InvalidCiphertext("StreamTransformationFilter: invalid PKCS #7 block padding found");
+            }
+
+            dst.resize(dst->size() - padding);
+        }
+
+        if (!gcm && !q->m_authentication.isEmpty() &&
+                keyMaker.authenticate(dst->constData() + offset, dst->size() - offset) != q->m_authentication)
+            throw HashVerificationFilter::HashVerificationFailed();
+
+        return NoError;
+    }
+
+    void setDecryptionKey(CryptoPP::SimpleKeyingInterface *keying, const KeyMaker &keyMaker)
+    {
+        if (keying->IVRequirement() == CryptoPP::SimpleKeyingInterface::NOT_RESYNCHRONIZABLE) {
+            keying->SetKey(keyMaker.keyData(), keyMaker.keyLength());
+        } else {
+            keying->SetKeyWithIV(keyMaker.keyData(), keyMaker.keyLength(),
+                                 reinterpret_cast<const CryptoPP::byte*>(q->m_initialVector.constData()),
+                                 q->m_initialVector.size());
+        }
+    }
+
+    void setEncryptionKey(CryptoPP::SimpleKeyingInterface *keying, const KeyMaker &keyMaker)
+    {
+        if (keying->IVRequirement() == CryptoPP::SimpleKeyingInterface::NOT_RESYNCHRONIZABLE) {
+            q->m_initialVector.clear();
+            keying->SetKey(keyMaker.keyData(), keyMaker.keyLength());
+        } else {
+            CryptoPP::AutoSeededRandomPool prng;
+            q->m_initialVector.resize(keying->IVSize());
+            keying->GetNextIV(prng, reinterpret_cast<CryptoPP::byte*>(q->m_initialVector.data()));
+            keying->SetKeyWithIV(keyMaker.keyData(), keyMaker.keyLength(),
+                                 reinterpret_cast<CryptoPP::byte*>(q->m_initialVector.data()));
+        }
+    }
+
+    CryptoPP::StreamTransformation *newDecryption()
+    {
+        switch (q->algorithm()) {
+        case Cipher::AES:
+            return getDecryption<CryptoPP::AES>();
+        case Cipher::Blowfish:
+            return getDecryption<CryptoPP::Blowfish>();
+        case Cipher::CAST_128:
+            return getDecryption<CryptoPP::CAST128>();
+        case Cipher::Camellia:
+            return getDecryption<CryptoPP::Camellia>();
+        case Cipher::DES_EDE3:
+            return getDecryption<CryptoPP::DES_EDE3>();
+        case Cipher::IDEA:
+            return getDecryption<CryptoPP::IDEA>();
+        case Cipher::SEED:
+            return getDecryption<CryptoPP::SEED>();
+        case Cipher::Serpent:
+            return getDecryption<CryptoPP::Serpent>();
+        case Cipher::Twofish:
+            return getDecryption<CryptoPP::Twofish>();
+        default:
+            return 0;
+        }
+    }
+
+    CryptoPP::StreamTransformation *newEncryption()
+    {
+        switch (q->algorithm()) {
+        case Cipher::AES:
+            return getEncryption<CryptoPP::AES>();
+        case Cipher::Blowfish:
+            return getEncryption<CryptoPP::Blowfish>();
+        case Cipher::CAST_128:
+            return getEncryption<CryptoPP::CAST128>();
+        case Cipher::Camellia:
+            return getEncryption<CryptoPP::Camellia>();
+        case Cipher::DES_EDE3:
+            return getEncryption<CryptoPP::DES_EDE3>();
+        case Cipher::IDEA:
+            return getEncryption<CryptoPP::IDEA>();
+        case Cipher::SEED:
+            return getEncryption<CryptoPP::SEED>();
+        case Cipher::Serpent:
+            return getEncryption<CryptoPP::Serpent>();
+        case Cipher::Twofish:
+            return getEncryption<CryptoPP::Twofish>();
+        default:
+            return 0;
+        }
+    }
+
     template <class Alg>
     CryptoPP::StreamTransformation *getDecryption()
     {
@@ -130,6 +835,8 @@ struct Cipher::Impl
             return new typename CryptoPP::GCM<Alg>::Decryption;
         case Cipher::OFB:
             return new typename CryptoPP::OFB_Mode<Alg>::Decryption;
+        case Cipher::STREAM:
+            return new typename CryptoPP::GCM<Alg>::Decryption;
         default:
             return 0;
         }
@@ -153,12 +860,210 @@ struct Cipher::Impl
             return new typename CryptoPP::GCM<Alg>::Encryption;
         case Cipher::OFB:
             return new typename CryptoPP::OFB_Mode<Alg>::Encryption;
+        case Cipher::STREAM:
+            return new typename CryptoPP::GCM<Alg>::Encryption;
         default:
             return 0;
         }
     }
 };
 
+/**
+ * @brief The SegmentSink class streams through STREAM segments,
+ * crypting a batch of segments per thread of the pool at once
+ */
+class Cipher::Impl::SegmentSink : public Sink
+{
+    Impl m_f;
+    const KeyMaker &m_keyMaker;
+    Sink *m_sink;
+    bool m_encryption;
+    quint32 m_counter;
+    SequreBytes m_input;
+    SequreBytes m_output;
+
+    Error flush(bool last)
+    {
+        const int unit = m_f.q->m_segmentSize + (m_encryption ? 0 : TagSize);
+        const int size = last ? m_input->size() : (m_input->size() - 1) / unit * unit; // the last segment is flagged
+        const qint64 cryptSize = m_f.cryptedSize(size, last, m_encryption);
+
+        if (cryptSize < 0 || cryptSize > std::numeric_limits<int>::max())
+            return m_error = InvalidFormat;
+
+        m_output.resize(int(cryptSize));
+
+        if ((m_error = m_f.cryptSegments(m_output->data(), m_input->constData(), size, m_counter, last,
+                                         m_keyMaker, m_encryption)))
+            return m_error;
+
+        m_counter += quint32(m_encryption ? (cryptSize - size) / TagSize : (size - cryptSize) / TagSize);
+        m_input->remove(0, size);
+        return m_sink->write(m_output->constData(), cryptSize);
+    }
+
+public:
+    SegmentSink(Cipher *q, Sink *sink, const KeyMaker &keyMaker, bool encryption) :
+        m_f(q),
+        m_keyMaker(keyMaker),
+        m_sink(sink),
+        m_encryption(encryption),
+        m_counter(0)
+    { }
+
+    Error write(const char *data, qint64 size)
+    {
+        const qint64 unit = qint64(m_f.q->m_segmentSize) + TagSize;
+        const qint64 batch = qBound<qint64>(1, QThread::idealThreadCount(), MaxBatchSize / unit) * unit;
+        Error error = m_error;
+
+        for (Pointerator<const char> it(data, qMax<qint64>(size, 0)); !error && !it.atEnd(); ) {
+            const Pointerator<const char> chunk(it.read(size_t(batch))); // input stays within two batches
+            m_input.append(chunk.data(), int(chunk.size()));
+
+            if (m_input->size() > batch)
+                error = flush(false);
+        }
+
+        return error;
+    }
+
+    Error close()
+    {
+        const Error error = m_error ? m_error : flush(true);
+
+        if (error)
+            return error;
+
+        if (m_encryption)
+            m_f.q->m_segmentCount = m_counter;
+        else if (m_f.q->m_segmentCount && m_f.q->m_segmentCount != m_counter)
+            return m_error = IntegrityError;
+
+        return m_sink->close();
+    }
+};
+
+/**
+ * @brief The SliceSink class streams CBC, CFB, CTR, ECB or GCM crypt data through batches of slices,
+ * decrypting a slice per thread of the pool at once
+ * @note the last TagSize bytes are held back, they are the GCM tag or end with the padded block
+ */
+class Cipher::Impl::SliceSink : public Sink
+{
+    Impl m_f;
+    Cipher m_stream;
+    const KeyMaker &m_keyMaker;
+    Sink *m_sink;
+    KeyMaker::Hmac m_hmac;
+    QVector<Slice> m_slices; ///< of the whole crypt data, for the GCM tag
+    SequreBytes m_input; ///< the previous crypt block followed by pending crypt data
+    SequreBytes m_output;
+    qint64 m_offset; ///< of pending crypt data
+    int m_carry; ///< size of the previous crypt block
+    int m_batch;
+    int m_blockSize;
+    bool m_verification;
+
+    /**
+     * @brief flush decrypts size bytes of pending crypt data into the next sink
+     * @param last removes the padding of the last CBC or ECB block
+     */
+    Error flush(int size, bool last)
+    {
+        const char *src = m_input->constData() + m_carry;
+        const Cipher::Operation operation = m_f.q->operation();
+        QVector<Slice> slices;
+        int plainSize = size;
+        m_output.resize(size);
+
+        if ((m_error = m_f.decryptSlices(slices, m_output->data(), src, size, m_offset, &m_stream, m_keyMaker)))
+            return m_error;
+
+        if (operation == Cipher::GCM) {
+            m_slices += slices;
+        } else if (last && (operation == Cipher::CBC || operation == Cipher::ECB)) {
+            const int padding = paddingSize(m_output->constData(), size, m_blockSize);
+
+            if (padding < 0)
+                return m_error = InvalidFormat;
+
+            plainSize -= padding;
+        }
+
+        const int carry = qMin(m_carry + size, int(TagSize)); // the previous crypt block of the next slice
+        m_input->remove(0, m_carry + size - carry);
+        m_carry = carry;
+        m_offset += size;
+
+        if (m_verification)
+            m_hmac.update(m_output->constData(), plainSize); // while the plain batch is in cache
+
+        return m_sink->write(m_output->constData(), plainSize);
+    }
+
+public:
+    SliceSink(Cipher *q, Sink *sink, const KeyMaker &keyMaker) :
+        m_f(q),
+        m_stream(*q),
+        m_keyMaker(keyMaker),
+        m_sink(sink),
+        m_offset(0),
+        m_carry(0),
+        m_batch(int(qBound<qint64>(1, QThread::idealThreadCount(), MaxBatchSize / SliceSize) * SliceSize)),
+        m_blockSize(1),
+        m_verification(q->operation() != Cipher::GCM && !q->m_authentication.isEmpty())
+    {
+        const QScopedPointer<CryptoPP::StreamTransformation> probe(m_f.newDecryption());
+        m_blockSize = int(probe->MandatoryBlockSize());
+
+        if (q->operation() == Cipher::GCM)
+            m_stream.setOperation(Cipher::CTR); // GCM keystream
+
+        if (m_verification && !m_hmac.init(keyMaker))
+            m_error = IntegrityError;
+    }
+
+    Error write(const char *data, qint64 size)
+    {
+        Error error = m_error;
+
+        for (Pointerator<const char> it(data, qMax<qint64>(size, 0)), chunk; !error && !it.atEnd(); ) {
+            chunk = it.read(size_t(m_batch)); // input stays within two batches
+            m_input.append(chunk.data(), int(chunk.size()));
+
+            if (m_input->size() - m_carry > m_batch + TagSize)
+                error = flush(m_batch, false);
+        }
+
+        return error;
+    }
+
+    Error close()
+    {
+        const bool gcm = m_f.q->operation() == Cipher::GCM;
+        const int size = m_input->size() - m_carry - (gcm ? TagSize : 0);
+        Error error = m_error;
+
+        if (!error && (size < 0 || (m_offset + size) % m_blockSize))
+            error = m_error = InvalidFormat;
+
+        if (!error)
+            error = flush(size, true);
+
+        if (error)
+            return error;
+
+        if (gcm && !m_f.verifySlices(m_slices, m_input->constData() + m_carry, m_offset, m_keyMaker))
+            return m_error = IntegrityError;
+
+        if (m_verification && m_hmac.final() != m_f.q->m_authentication)
+            return m_error = IntegrityError;
+
+        return m_sink->close();
+    }
+};
+
 }
 
 using namespace Qrypto;
@@ -176,50 +1081,18 @@ const QStringList Cipher::AlgorithmNames =
                          QString();
 
 const QStringList Cipher::OperationCodes =
-        QStringList() << "CBC" << "CFB" << "CTR" << "EAX" << "ECB" << "GCM" << "OFB" << QString();
+        QStringList() << "CBC" << "CFB" << "CTR" << "EAX" << "ECB" << "GCM" << "OFB" << "STREAM" << QString();
 
-Error Cipher::decrypt(SequreBytes &plain, const QByteArray &crypt, const KeyMaker &keyMaker)
+Error Cipher::decrypt(SequreBytes &plain, const char *cryptData, int cryptSize, const KeyMaker &keyMaker)
 {
-    QScopedPointer<CryptoPP::Algorithm> cipher;
     Impl f(this);
-
-    switch (algorithm()) {
-    case AES:
-        cipher.reset(f.getDecryption<CryptoPP::AES>());
-        break;
-    case Blowfish:
-        cipher.reset(f.getDecryption<CryptoPP::Blowfish>());
-        break;
-    case CAST_128:
-        cipher.reset(f.getDecryption<CryptoPP::CAST128>());
-        break;
-    case Camellia:
-        cipher.reset(f.getDecryption<CryptoPP::Camellia>());
-        break;
-    case DES_EDE3:
-        cipher.reset(f.getDecryption<CryptoPP::DES_EDE3>());
-        break;
-    case IDEA:
-        cipher.reset(f.getDecryption<CryptoPP::IDEA>());
-        break;
-    case SEED:
-        cipher.reset(f.getDecryption<CryptoPP::SEED>());
-        break;
-    case Serpent:
-        cipher.reset(f.getDecryption<CryptoPP::Serpent>());
-        break;
-    case Twofish:
-        cipher.reset(f.getDecryption<CryptoPP::Twofish>());
-        break;
-    default:
-        break;
-    }
+    QScopedPointer<CryptoPP::Algorithm> cipher(f.newDecryption());
 
     if (cipher.isNull())
         return NotImplemented;
 
     try {
-        return f.decrypt(cipher.data(), plain, crypt, keyMaker);
+        return f.decrypt(cipher.data(), plain, cryptData, cryptSize, keyMaker);
     } catch (const std::bad_alloc &exc) {
         return OutOfMemory;
     } catch (const CryptoPP::Exception &exc) {
@@ -240,48 +1113,16 @@ Error Cipher::decrypt(SequreBytes &plain, const QByteArray &crypt, const KeyMake
     }
 }
 
-Error Cipher::encrypt(QByteArray &crypt, const SequreBytes &plain, const KeyMaker &keyMaker)
+Error Cipher::encrypt(QByteArray &crypt, const char *plainData, int plainSize, const KeyMaker &keyMaker)
 {
-    QScopedPointer<CryptoPP::Algorithm> cipher;
     Impl f(this);
-
-    switch (algorithm()) {
-    case AES:
-        cipher.reset(f.getEncryption<CryptoPP::AES>());
-        break;
-    case Blowfish:
-        cipher.reset(f.getEncryption<CryptoPP::Blowfish>());
-        break;
-    case CAST_128:
-        cipher.reset(f.getEncryption<CryptoPP::CAST128>());
-        break;
-    case Camellia:
-        cipher.reset(f.getEncryption<CryptoPP::Camellia>());
-        break;
-    case DES_EDE3:
-        cipher.reset(f.getEncryption<CryptoPP::DES_EDE3>());
-        break;
-    case IDEA:
-        cipher.reset(f.getEncryption<CryptoPP::IDEA>());
-        break;
-    case SEED:
-        cipher.reset(f.getEncryption<CryptoPP::SEED>());
-        break;
-    case Serpent:
-        cipher.reset(f.getEncryption<CryptoPP::Serpent>());
-        break;
-    case Twofish:
-        cipher.reset(f.getEncryption<CryptoPP::Twofish>());
-        break;
-    default:
-        break;
-    }
+    QScopedPointer<CryptoPP::Algorithm> cipher(f.newEncryption());
 
     if (cipher.isNull())
         return NotImplemented;
 
     try {
-        return f.encrypt(cipher.data(), crypt, plain, keyMaker);
+        return f.encrypt(cipher.data(), crypt, plainData, plainSize, keyMaker);
     } catch (const std::bad_alloc &exc) {
         return OutOfMemory;
     } catch (const CryptoPP::Exception &exc) {
@@ -298,6 +1139,98 @@ Error Cipher::encrypt(QByteArray &crypt, const SequreBytes &plain, const KeyMake
     }
 }
 
+Sink *Cipher::decryptor(Sink *sink, const KeyMaker &keyMaker, Error *error)
+{
+    Impl f(this);
+    CryptoPP::Algorithm *cipher = f.newDecryption();
+    QScopedPointer<CipherSink> stage(cipher ? new CipherSink(this, cipher) : 0);
+    QScopedPointer<Sink> segments;
+    Error e = NotImplemented;
+
+    try {
+        if (stage) {
+            CryptoPP::SimpleKeyingInterface *keying = dynamic_cast<CryptoPP::SimpleKeyingInterface*>(cipher);
+
+            if (!keying->IsValidKeyLength(keyMaker.keyLength()))
+                throw CryptoPP::InvalidKeyLength(cipher->AlgorithmName(), keyMaker.keyLength());
+
+            if (operation() == STREAM) {
+                if (m_initialVector.size() != Impl::PrefixSize)
+                    throw CryptoPP::InvalidArgument("STREAM: initial vector is not a valid nonce prefix");
+
+                segments.reset(new Impl::SegmentSink(this, sink, keyMaker, false));
+            } else if (f.isSliceable()) {
+                segments.reset(new Impl::SliceSink(this, sink, keyMaker));
+            } else {
+                f.setDecryptionKey(keying, keyMaker);
+                stage->decrypt(sink, keyMaker);
+            }
+
+            e = NoError;
+        }
+    } catch (const std::bad_alloc &exc) {
+        e = OutOfMemory;
+    } catch (const CryptoPP::Exception &exc) {
+        qCritical("%s", exc.what());
+        e = toError(exc);
+    }
+
+    if (error)
+        *error = e;
+
+    if (e)
+        return 0;
+    else if (segments)
+        return segments.take();
+    else
+        return stage.take();
+}
+
+Sink *Cipher::encryptor(Sink *sink, const KeyMaker &keyMaker, Error *error)
+{
+    Impl f(this);
+    CryptoPP::Algorithm *cipher = f.newEncryption();
+    QScopedPointer<CipherSink> stage(cipher ? new CipherSink(this, cipher) : 0);
+    QScopedPointer<Sink> segments;
+    Error e = NotImplemented;
+
+    try {
+        if (stage) {
+            CryptoPP::SimpleKeyingInterface *keying = dynamic_cast<CryptoPP::SimpleKeyingInterface*>(cipher);
+
+            if (!keying->IsValidKeyLength(keyMaker.keyLength()))
+                throw CryptoPP::InvalidKeyLength(cipher->AlgorithmName(), keyMaker.keyLength());
+
+            if (operation() == STREAM) {
+                f.newPrefix();
+                m_authentication.clear();
+                m_segmentCount = 0;
+                segments.reset(new Impl::SegmentSink(this, sink, keyMaker, true));
+            } else {
+                f.setEncryptionKey(keying, keyMaker);
+                stage->encrypt(sink, keyMaker);
+            }
+
+            e = NoError;
+        }
+    } catch (const std::bad_alloc &exc) {
+        e = OutOfMemory;
+    } catch (const CryptoPP::Exception &exc) {
+        qCritical("%s", exc.what());
+        e = toError(exc);
+    }
+
+    if (error)
+        *error = e;
+
+    if (e)
+        return 0;
+    else if (segments)
+        return segments.take();
+    else
+        return stage.take();
+}
+
 uint Cipher::validateKeyLength(uint keyLength)
 {
     switch (algorithm()) {
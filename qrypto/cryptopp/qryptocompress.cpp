@@ -1,105 +1,713 @@
 #include "../qryptocompress.h"
 
+#include "../qryptocodec.h"
 #include "../sequre.h"
+#include "qryptofilter.h"
 
+#include <QElapsedTimer>
 #include <QScopedPointer>
+#include <QThread>
+#include <QVector>
+#include <QtConcurrentMap>
+
+#include "../pointerator.h"
 
 #include <cryptopp/gzip.h>
 #include <cryptopp/zlib.h>
 
+#include <cmath>
+
 namespace Qrypto
 {
 typedef CryptoPP::StringSinkTemplate<SequreBytes> SequreSink;
+
+/// Zstd matches over a long distance beyond the window of its levels
+const int LongDistanceSize = 8 << 20;
+
+/// least input gathered by a MemberSink before flushing
+const int ChunkSize = 65536;
+
+/// bits per byte above which adapt doesn't compress
+const double IncompressibleEntropy = 7.5;
+
+/// adapt candidates from the fastest to the strongest
+const struct {
+    Compress::Algorithm algorithm;
+    int deflateLevel;
+} Adaptations[] = {
+    { Compress::Lz4, 0 },
+    { Compress::Zstd, 3 },
+    { Compress::Zstd, 9 },
+    { Compress::Zstd, 15 },
+    { Compress::Lzma, 6 }
+};
 }
 
 using namespace Qrypto;
 
 const QStringList Compress::AlgorithmNames =
-        QStringList() << QString() <<
+        QStringList() << "Bz2" <<
                          "Deflate" <<
                          "GZip" <<
                          "Identity" <<
-                         QString() <<
+                         "Lz4" <<
+                         "Lzma" <<
                          "ZLib" <<
+                         "Zstd" <<
                          QString();
 
-Error Compress::deflate(SequreBytes &deflated, const QByteArray &data, int deflateLevel)
+struct Compress::Impl
 {
-    QScopedPointer<CryptoPP::Deflator> deflator;
-    deflateLevel = qBound(0, deflateLevel, 9);
+    Compress *q;
+
+    Impl(Compress *q) : q(q) { }
+
+    /**
+     * @brief The Member struct is an independent compressed stream processed by a thread of the pool
+     */
+    struct Member
+    {
+        const char *src;
+        int size;
+        SequreBytes dst;
+        Error error;
+    };
+
+    /**
+     * @brief The MemberTransform struct deflates or inflates a Member
+     */
+    struct MemberTransform
+    {
+        typedef void result_type;
+        Algorithm algorithm;
+        QByteArray dictionary;
+        int deflateLevel;
+        bool inflation;
+
+        MemberTransform(Algorithm algorithm, const QByteArray &dictionary, int deflateLevel, bool inflation) :
+            algorithm(algorithm),
+            dictionary(dictionary),
+            deflateLevel(deflateLevel),
+            inflation(inflation)
+        { }
+
+        void operator()(Member &member) const
+        {
+            member.error = inflation ? Impl::inflate(algorithm, dictionary, member.dst, member.src, member.size, false) :
+                                       Impl::deflate(algorithm, dictionary, member.dst, member.src, member.size, deflateLevel);
+        }
+    };
+
+    class MemberSink;
+
+    /**
+     * @brief dictionary content for the algorithm, Zstd only
+     * @return NotImplemented for an unknown dictionary
+     */
+    Error dictionary(QByteArray &content) const
+    {
+        content.clear();
+
+        if (q->algorithm() != Zstd || q->m_dictionary == NoDictionary)
+            return NoError;
+
+        content = dictionaryContent(q->m_dictionary);
+        return content.isEmpty() ? NotImplemented : NoError;
+    }
+
+    /**
+     * @brief entropy of the byte distribution in 16 windows spread over data
+     * @return bits per byte
+     */
+    static double entropy(const char *data, int size)
+    {
+        const int window = qMin(size / 16 + 1, 4096);
+        const int step = size / 16 + 1;
+        qint64 counts[256] = { 0 };
+        qint64 total = 0;
+        double bits = 0;
+
+        for (int from = 0; from < size; from += step) {
+            const uchar *byte = reinterpret_cast<const uchar*>(data + from);
+
+            for (const uchar *end = byte + qMin(window, size - from); byte != end; ++byte)
+                ++counts[*byte];
+
+            total += qMin(window, size - from);
+        }
+
+        for (int i = 0; i < 256; ++i) {
+            if (counts[i])
+                bits -= counts[i] * std::log2(double(counts[i]) / total);
+        }
+
+        return total ? bits / total : 0;
+    }
+
+    static bool hasMembers(Algorithm algorithm)
+    { return algorithm != Identity && algorithm != Lzma && algorithm != UnknownAlgorithm; }
+
+    /**
+     * @brief level bounded to the range of the algorithm
+     */
+    static int level(Algorithm algorithm, int deflateLevel)
+    {
+        switch (algorithm) {
+        case Lz4:
+            return qBound(0, deflateLevel, 12);
+        case Zstd:
+            return qBound(ZSTD_minCLevel(), deflateLevel, ZSTD_maxCLevel());
+        default:
+            return qBound(0, deflateLevel, 9);
+        }
+    }
+
+    /**
+     * @brief codec creates the CodecSink of algorithms outside of CryptoPP
+     * @param dictionary of Zstd
+     * @param blockSize of Lzma threads
+     * @param longDistance matching of Zstd
+     * @param workers threads of Zstd for a single stream, 0 for members, which are compressed on every thread already
+     * @return null for CryptoPP algorithms
+     */
+    static CodecSink *codec(Algorithm algorithm, const QByteArray &dictionary, Sink *sink, int deflateLevel,
+                            bool inflation, int blockSize = 0, bool longDistance = false, int workers = 0)
+    {
+        switch (algorithm) {
+        case Bz2:
+            return new Bz2Sink(sink, deflateLevel, inflation);
+        case Lz4:
+            return new Lz4Sink(sink, deflateLevel, inflation);
+        case Lzma:
+            return new LzmaSink(sink, deflateLevel, inflation, blockSize);
+        case Zstd:
+            return new ZstdSink(sink, deflateLevel, inflation, longDistance, dictionary, workers);
+        default:
+            return 0;
+        }
+    }
+
+    /**
+     * @brief code data through a CodecSink into dst
+     * @return codec error
+     */
+    static Error code(CodecSink *codec, SequreBytes &dst, const char *data, int size)
+    {
+        QScopedPointer<CodecSink> guard(codec);
+        dst.resize(0);
+        const Error error = codec->write(data, size);
+        return error ? error : codec->close();
+    }
+
+    /**
+     * @brief split data into members of memberSize, or of the members index on inflation
+     * @return members covering size bytes, empty if the index doesn't match
+     */
+    QVector<Member> split(const char *data, int size, bool inflation) const
+    {
+        QVector<Member> members;
+        Member member;
+        member.error = NoError;
+
+        if (inflation) {
+            members.reserve(q->m_members.size());
+
+            foreach (const int memberSize, q->m_members) {
+                if (memberSize <= 0 || memberSize > size)
+                    return QVector<Member>();
+
+                member.src = data;
+                member.size = memberSize;
+                members.append(member);
+                data += memberSize;
+                size -= memberSize;
+            }
+
+            if (size)
+                members.clear();
+        } else {
+            members.reserve(size / q->memberSize() + 1);
+
+            for (Pointerator<const char> it(data, size); !it.atEnd() || members.isEmpty(); ) {
+                const Pointerator<const char> chunk(it.read(q->memberSize()));
+                member.src = chunk.data();
+                member.size = chunk.size();
+                members.append(member);
+            }
+        }
+
+        return members;
+    }
+
+    /**
+     * @brief transform members in parallel appending them to dst
+     * @return first member error
+     */
+    Error transform(SequreBytes &dst, QVector<Member> &members, int deflateLevel, bool inflation)
+    {
+        QByteArray content;
+        const Error error = dictionary(content);
+        int size = 0;
+
+        if (error)
+            return error;
+
+        QtConcurrent::blockingMap(members, MemberTransform(q->algorithm(), content, deflateLevel, inflation));
+
+        foreach (const Member &member, members) {
+            if (member.error)
+                return member.error;
+
+            size += member.dst->size();
+        }
+
+        dst.reserve(dst->size() + size);
+
+        foreach (const Member &member, members) {
+            dst += member.dst;
+
+            if (!inflation)
+                q->m_members.append(member.dst->size());
+        }
 
-    switch (algorithm()) {
-    case Identity:
-        deflated.assign(data);
         return NoError;
-    case Deflate:
-        deflator.reset(new CryptoPP::Deflator(new SequreSink(deflated), deflateLevel));
-        break;
-    case GZip:
-        deflator.reset(new CryptoPP::Gzip(new SequreSink(deflated), deflateLevel));
-        break;
-    case ZLib:
-        deflator.reset(new CryptoPP::ZlibCompressor(new SequreSink(deflated), deflateLevel));
-        break;
-    default:
-        return NotImplemented;
     }
 
-    try {
-        deflated.reserve(data.size());
+    static Error deflate(Algorithm algorithm, const QByteArray &dictionary, SequreBytes &deflated, const char *data, int size, int deflateLevel,
+                         int blockSize = 0, int workers = 0)
+    {
+        QScopedPointer<CryptoPP::Deflator> deflator;
+        BytesSink sink(deflated);
+        deflateLevel = level(algorithm, deflateLevel);
+
+        switch (algorithm) {
+        case Bz2:
+        case Lz4:
+        case Lzma:
+        case Zstd:
+            deflated.reserve(size / 2);
+            return code(codec(algorithm, dictionary, &sink, deflateLevel, false, blockSize, size > LongDistanceSize, workers),
+                        deflated, data, size);
+        case Identity:
+            deflated.resize(0);
+            deflated.append(data, size);
+            return NoError;
+        case Deflate:
+            deflator.reset(new CryptoPP::Deflator(new SequreSink(deflated), deflateLevel));
+            break;
+        case GZip:
+            deflator.reset(new CryptoPP::Gzip(new SequreSink(deflated), deflateLevel));
+            break;
+        case ZLib:
+            deflator.reset(new CryptoPP::ZlibCompressor(new SequreSink(deflated), deflateLevel));
+            break;
+        default:
+            return NotImplemented;
+        }
+
+        try {
+            deflated.reserve(size);
+            deflated.resize(0);
+            CryptoPP::StringSource(reinterpret_cast<const CryptoPP::byte*>(data), size, true, deflator.take());
+            return NoError;
+        } catch (const std::bad_alloc &exc) {
+            return OutOfMemory;
+        } catch (const std::exception &exc) {
+            qCritical("%s", exc.what());
+            return UnknownError;
+        }
+    }
+
+    static Error inflate(Algorithm algorithm, const QByteArray &dictionary, SequreBytes &inflated, const char *data, int size, bool repeat)
+    {
+        QScopedPointer<CryptoPP::Inflator> inflator;
+        BytesSink sink(inflated);
+
+        switch (algorithm) {
+        case Bz2:
+        case Lz4:
+        case Lzma:
+        case Zstd:
+            return code(codec(algorithm, dictionary, &sink, 0, true), inflated, data, size);
+        case Identity:
+            inflated.resize(0);
+            inflated.append(data, size);
+            return NoError;
+        case Deflate:
+            inflator.reset(new CryptoPP::Inflator(new SequreSink(inflated), repeat));
+            break;
+        case GZip:
+            inflator.reset(new CryptoPP::Gunzip(new SequreSink(inflated), repeat));
+            break;
+        case ZLib:
+            inflator.reset(new CryptoPP::ZlibDecompressor(new SequreSink(inflated), repeat));
+            break;
+        default:
+            return NotImplemented;
+        }
+
+        try {
+            inflated.reserve(size);
+            inflated.resize(0);
+            CryptoPP::StringSource(reinterpret_cast<const CryptoPP::byte*>(data), size, true, inflator.take());
+            return NoError;
+        } catch (const std::bad_alloc &exc) {
+            return OutOfMemory;
+        } catch (const CryptoPP::Exception &exc) {
+            switch (exc.GetErrorType()) {
+            case CryptoPP::Exception::INVALID_DATA_FORMAT:
+                return InvalidFormat;
+            case CryptoPP::Exception::DATA_INTEGRITY_CHECK_FAILED:
+                return IntegrityError;
+            default:
+                qCritical("%s", exc.what());
+                return UnknownError;
+            }
+        } catch (const std::exception &exc) {
+            qCritical("%s", exc.what());
+            return UnknownError;
+        }
+    }
+};
+
+/**
+ * @brief The MemberSink class streams through members, transforming a batch of members per thread at once
+ */
+class Compress::Impl::MemberSink : public Sink
+{
+    Impl m_f;
+    Sink *m_sink;
+    int m_deflateLevel;
+    bool m_inflation;
+    int m_next;
+    SequreBytes m_input;
+    SequreBytes m_output;
+
+    /**
+     * @brief deflatable members of input, a whole batch or all of the last ones
+     */
+    QVector<Member> deflatable(bool last) const
+    {
+        const qint64 batch = qint64(QThread::idealThreadCount()) * m_f.q->memberSize();
+        QVector<Member> members;
+        Member member;
+        member.error = NoError;
+
+        if (!last && m_input->size() < batch)
+            return members;
+
+        for (Pointerator<const char> it(m_input->constData(), last ? m_input->size() : int(batch));
+             !it.atEnd() || (last && members.isEmpty()); ) {
+            const Pointerator<const char> chunk(it.read(m_f.q->memberSize()));
+            member.src = chunk.data();
+            member.size = chunk.size();
+            members.append(member);
+        }
+
+        return members;
+    }
+
+    /**
+     * @brief inflatable members of input, a whole batch or all of the last ones
+     */
+    QVector<Member> inflatable(bool last) const
+    {
+        const QList<int> &index = m_f.q->m_members;
+        const int batch = QThread::idealThreadCount();
+        const char *data = m_input->constData();
+        int size = m_input->size();
+        int next = m_next;
+        QVector<Member> members;
+        Member member;
+        member.error = NoError;
+
+        for (; next < index.size() && index.at(next) > 0 && index.at(next) <= size && (last || members.size() < batch); ++next) {
+            member.src = data;
+            member.size = index.at(next);
+            members.append(member);
+            data += member.size;
+            size -= member.size;
+        }
+
+        if (!last && members.size() < batch && next < index.size())
+            members.clear(); // wait for a whole batch
+
+        return members;
+    }
+
+    /**
+     * @brief batchSize of input for a member per thread, from the members index on inflation
+     * @note never 0, the index may come without a memberSize
+     */
+    qint64 batchSize() const
+    {
+        const int threads = qMax(QThread::idealThreadCount(), 1);
+        const QList<int> &index = m_f.q->m_members;
+        qint64 size = 0;
+
+        if (!m_inflation)
+            return qMax<qint64>(qint64(threads) * m_f.q->memberSize(), ChunkSize);
+
+        for (int next = m_next; next < index.size() && next < m_next + threads; ++next)
+            size += qMax(index.at(next), 0);
+
+        return qMax<qint64>(size, ChunkSize);
+    }
+
+    /**
+     * @brief flush transforms the members of input into the next sink
+     * @param last transforms all remaining input
+     */
+    Error flush(bool last)
+    {
+        QVector<Member> members(m_inflation ? inflatable(last) : deflatable(last));
+        int size = 0;
+
+        foreach (const Member &member, members)
+            size += member.size;
+
+        if (last && (size != m_input->size() || (m_inflation && m_next + members.size() != m_f.q->m_members.size())))
+            return m_error = InvalidFormat;
+        else if (members.isEmpty())
+            return NoError;
+
+        m_output.resize(0);
+
+        if ((m_error = m_f.transform(m_output, members, m_deflateLevel, m_inflation)))
+            return m_error;
+
+        m_next += members.size();
+        m_input->remove(0, size);
+        return m_sink->write(m_output->constData(), m_output->size());
+    }
+
+public:
+    MemberSink(Compress *q, Sink *sink, int deflateLevel, bool inflation) :
+        m_f(q),
+        m_sink(sink),
+        m_deflateLevel(deflateLevel),
+        m_inflation(inflation),
+        m_next(0)
+    { }
+
+    Error write(const char *data, qint64 size)
+    {
+        const qint64 batch = batchSize();
+        Error error = m_error;
+
+        for (Pointerator<const char> it(data, qMax<qint64>(size, 0)); !error && !it.atEnd(); ) {
+            const Pointerator<const char> chunk(it.read(batch)); // input stays within a few batches
+            m_input.append(chunk.data(), int(chunk.size()));
+
+            for (int input = -1; !error && input != m_input->size(); ) {
+                input = m_input->size();
+                error = flush(false);
+            }
+        }
+
+        return error;
+    }
+
+    Error close()
+    {
+        const Error error = m_error ? m_error : flush(true);
+        return error ? error : m_sink->close();
+    }
+};
+
+Error Compress::deflate(SequreBytes &deflated, const char *data, int size, int deflateLevel)
+{
+    Impl f(this);
+    QByteArray dictionary;
+    m_members.clear();
+    deflateLevel = Impl::level(algorithm(), deflateLevel);
+
+    if (const Error error = f.dictionary(dictionary))
+        return error;
+
+    if (memberSize() > 0 && size > memberSize() && Impl::hasMembers(algorithm())) {
+        QVector<Impl::Member> members(f.split(data, size, false));
         deflated.resize(0);
-        CryptoPP::StringSource(reinterpret_cast<const CryptoPP::byte*>(data.constData()), data.size(),
-                               true, deflator.take());
-        return NoError;
-    } catch (const std::bad_alloc &exc) {
-        return OutOfMemory;
-    } catch (const std::exception &exc) {
-        qCritical("%s", exc.what());
-        return UnknownError;
+        return f.transform(deflated, members, deflateLevel, false);
     }
+
+    return Impl::deflate(algorithm(), dictionary, deflated, data, size, deflateLevel, m_memberSize,
+                         QThread::idealThreadCount()); // a single stream, unlike members
 }
 
-Error Compress::inflate(SequreBytes &inflated, const QByteArray &data, bool repeat)
+Error Compress::inflate(SequreBytes &inflated, const char *data, int size, bool repeat)
 {
-    QScopedPointer<CryptoPP::Inflator> inflator;
+    Impl f(this);
+    QByteArray dictionary;
 
-    switch (algorithm()) {
-    case Identity:
-        inflated.assign(data);
-        return NoError;
-    case Deflate:
-        inflator.reset(new CryptoPP::Inflator(new SequreSink(inflated), repeat));
-        break;
-    case GZip:
-        inflator.reset(new CryptoPP::Gunzip(new SequreSink(inflated), repeat));
-        break;
-    case ZLib:
-        inflator.reset(new CryptoPP::ZlibDecompressor(new SequreSink(inflated), repeat));
-        break;
-    default:
-        return NotImplemented;
+    if (const Error error = f.dictionary(dictionary))
+        return error;
+
+    if (m_members.size() > 1 && Impl::hasMembers(algorithm())) {
+        QVector<Impl::Member> members(f.split(data, size, true));
+
+        if (!members.isEmpty()) {
+            inflated.resize(0);
+            return f.transform(inflated, members, 0, true);
+        }
+
+        repeat = true; // the index doesn't match, still try the members in series
+    }
+
+    return Impl::inflate(algorithm(), dictionary, inflated, data, size, repeat);
+}
+
+void Compress::adapt(const char *data, int size, qint64 total)
+{
+    const int probe = qMin(size, ProbeSize);
+    const char *sample = data + (size - probe) / 2;
+    SequreBytes deflated;
+    QElapsedTimer timer;
+
+    if (!m_deflateTime || size <= 0)
+        return;
+
+    if (Impl::entropy(data, size) > IncompressibleEntropy) {
+        setAlgorithm(Identity);
+        return;
+    }
+
+    total = qMax<qint64>(total, size);
+
+    for (uint i = 0; i < sizeof Adaptations / sizeof *Adaptations; ++i) {
+        const QByteArray dictionary(Adaptations[i].algorithm == Zstd ? dictionaryContent(m_dictionary) : QByteArray());
+        timer.start();
+
+        if (Impl::deflate(Adaptations[i].algorithm, dictionary, deflated, sample, probe, Adaptations[i].deflateLevel))
+            continue;
+        else if (i && timer.nsecsElapsed() / 1000000.0 * total / probe > m_deflateTime)
+            break;
+
+        if (!i && deflated->size() > probe - probe / 32) {
+            setAlgorithm(Identity); // saves less than 3%
+            break;
+        }
+
+        setAlgorithm(Adaptations[i].algorithm);
+        m_deflateLevel = Adaptations[i].deflateLevel;
+    }
+}
+
+Sink *Compress::deflater(Sink *sink, int deflateLevel, Error *error)
+{
+    QScopedPointer<CryptoPP::BufferedTransformation> filter;
+    QScopedPointer<CodecSink> codec;
+    QByteArray dictionary;
+    Error e = Impl(this).dictionary(dictionary);
+    deflateLevel = Impl::level(algorithm(), deflateLevel);
+    m_members.clear();
+
+    if (e) {
+        if (error)
+            *error = e;
+
+        return 0;
+    }
+
+    if (memberSize() > 0 && Impl::hasMembers(algorithm())) {
+        if (error)
+            *error = NoError;
+
+        return new Impl::MemberSink(this, sink, deflateLevel, false);
+    }
+
+    codec.reset(Impl::codec(algorithm(), dictionary, sink, deflateLevel, false, m_memberSize, false,
+                            QThread::idealThreadCount()));
+
+    if (codec) {
+        e = codec->open();
+
+        if (error)
+            *error = e;
+
+        return e ? 0 : codec.take();
     }
 
     try {
-        inflated.reserve(data.size());
-        inflated.resize(0);
-        CryptoPP::StringSource(reinterpret_cast<const CryptoPP::byte*>(data.constData()), data.size(),
-                               true, inflator.take());
-        return NoError;
+        switch (algorithm()) {
+        case Identity:
+            filter.reset(new ForwardSink(sink));
+            break;
+        case Deflate:
+            filter.reset(new CryptoPP::Deflator(new ForwardSink(sink), deflateLevel));
+            break;
+        case GZip:
+            filter.reset(new CryptoPP::Gzip(new ForwardSink(sink), deflateLevel));
+            break;
+        case ZLib:
+            filter.reset(new CryptoPP::ZlibCompressor(new ForwardSink(sink), deflateLevel));
+            break;
+        default:
+            e = NotImplemented;
+        }
     } catch (const std::bad_alloc &exc) {
-        return OutOfMemory;
-    } catch (const CryptoPP::Exception &exc) {
-        switch (exc.GetErrorType()) {
-        case CryptoPP::Exception::INVALID_DATA_FORMAT:
-            return InvalidFormat;
-        case CryptoPP::Exception::DATA_INTEGRITY_CHECK_FAILED:
-            return IntegrityError;
+        e = OutOfMemory;
+    }
+
+    if (error)
+        *error = e;
+
+    return e ? 0 : new FilterSink(filter.take());
+}
+
+Sink *Compress::inflater(Sink *sink, bool repeat, Error *error)
+{
+    QScopedPointer<CryptoPP::BufferedTransformation> filter;
+    QScopedPointer<CodecSink> codec;
+    QByteArray dictionary;
+    Error e = Impl(this).dictionary(dictionary);
+
+    if (e) {
+        if (error)
+            *error = e;
+
+        return 0;
+    } else if (m_members.size() > 1 && Impl::hasMembers(algorithm())) {
+        if (error)
+            *error = NoError;
+
+        return new Impl::MemberSink(this, sink, 0, true);
+    }
+
+    codec.reset(Impl::codec(algorithm(), dictionary, sink, 0, true));
+
+    if (codec) {
+        e = codec->open();
+
+        if (error)
+            *error = e;
+
+        return e ? 0 : codec.take();
+    }
+
+    try {
+        switch (algorithm()) {
+        case Identity:
+            filter.reset(new ForwardSink(sink));
+            break;
+        case Deflate:
+            filter.reset(new CryptoPP::Inflator(new ForwardSink(sink), repeat));
+            break;
+        case GZip:
+            filter.reset(new CryptoPP::Gunzip(new ForwardSink(sink), repeat));
+            break;
+        case ZLib:
+            filter.reset(new CryptoPP::ZlibDecompressor(new ForwardSink(sink), repeat));
+            break;
         default:
-            qCritical("%s", exc.what());
-            return UnknownError;
+            e = NotImplemented;
         }
-    } catch (const std::exception &exc) {
-        qCritical("%s", exc.what());
-        return UnknownError;
+    } catch (const std::bad_alloc &exc) {
+        e = OutOfMemory;
     }
+
+    if (error)
+        *error = e;
+
+    return e ? 0 : new FilterSink(filter.take());
 }
@@ -0,0 +1,172 @@
+/* Qrypto 2019
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** CryptoPP 5.6.2 is licensed under Boost Software License 1.0
+**/
+#ifndef QRYPTO_CRYPTOPP_FILTER_H
+#define QRYPTO_CRYPTOPP_FILTER_H
+
+#include "../qryptosink.h"
+
+#include <QScopedPointer>
+
+#include <cryptopp/cryptlib.h>
+#include <cryptopp/filters.h>
+#include <cryptopp/simple.h>
+
+#include <new>
+
+namespace Qrypto
+{
+
+/**
+ * @brief The ForwardError struct carries the error of a following Sink through CryptoPP filters
+ */
+struct ForwardError
+{
+    Error error;
+
+    ForwardError(Error error) : error(error) { }
+};
+
+inline Error toError(const CryptoPP::Exception &exc)
+{
+    switch (exc.GetErrorType()) {
+    case CryptoPP::Exception::NOT_IMPLEMENTED:
+        return NotImplemented;
+    case CryptoPP::Exception::INVALID_ARGUMENT:
+        return InvalidArgument;
+    case CryptoPP::Exception::DATA_INTEGRITY_CHECK_FAILED:
+        return IntegrityError;
+    case CryptoPP::Exception::INVALID_DATA_FORMAT:
+        return InvalidFormat;
+    default:
+        return UnknownError;
+    }
+}
+
+/**
+ * @brief The ForwardSink class terminates a CryptoPP filter chain into a Qrypto::Sink
+ */
+class ForwardSink : public CryptoPP::Bufferless<CryptoPP::Sink>
+{
+    Qrypto::Sink *m_sink;
+
+public:
+    ForwardSink(Qrypto::Sink *sink) :
+        m_sink(sink)
+    { }
+
+    size_t Put2(const CryptoPP::byte *inString, size_t length, int messageEnd, bool blocking)
+    {
+        Q_UNUSED(blocking);
+        Error error = NoError;
+
+        if (length)
+            error = m_sink->write(reinterpret_cast<const char*>(inString), length);
+
+        if (!error && messageEnd)
+            error = m_sink->close();
+
+        if (error)
+            throw ForwardError(error);
+
+        return 0;
+    }
+};
+
+/**
+ * @brief The AppendSink class terminates a CryptoPP filter chain by appending to a byte container
+ * @note unlike StringSinkTemplate it only needs append(const char*, int), reserve the container in advance
+ */
+template <class T>
+class AppendSink : public CryptoPP::Bufferless<CryptoPP::Sink>
+{
+    T &m_output;
+
+public:
+    AppendSink(T &output) :
+        m_output(output)
+    { }
+
+    size_t Put2(const CryptoPP::byte *inString, size_t length, int messageEnd, bool blocking)
+    {
+        Q_UNUSED(messageEnd);
+        Q_UNUSED(blocking);
+
+        if (length)
+            m_output.append(reinterpret_cast<const char*>(inString), int(length));
+
+        return 0;
+    }
+};
+
+/**
+ * @brief The FilterSink class feeds a Qrypto::Sink stream into a CryptoPP filter chain
+ * @note only errors raised by the filter itself are kept in error()
+ */
+class FilterSink : public Qrypto::Sink
+{
+protected:
+    QScopedPointer<CryptoPP::BufferedTransformation> m_filter;
+
+    Error put(const char *data, qint64 size, bool messageEnd)
+    {
+        if (m_error)
+            return m_error;
+
+        try {
+            if (size > 0)
+                m_filter->Put(reinterpret_cast<const CryptoPP::byte*>(data), size);
+
+            if (messageEnd)
+                m_filter->MessageEnd();
+
+            return NoError;
+        } catch (const ForwardError &exc) {
+            return exc.error;
+        } catch (const std::bad_alloc &exc) {
+            return m_error = OutOfMemory;
+        } catch (const CryptoPP::Exception &exc) {
+            qCritical("%s", exc.what());
+            return m_error = toError(exc);
+        } catch (const std::exception &exc) {
+            qCritical("%s", exc.what());
+            return m_error = UnknownError;
+        }
+    }
+
+    /**
+     * @brief FilterSink for sinks that install their filter later
+     */
+    FilterSink() :
+        m_filter(0)
+    { }
+
+public:
+    /**
+     * @brief FilterSink
+     * @param filter will be owned, typically with a ForwardSink attached
+     */
+    FilterSink(CryptoPP::BufferedTransformation *filter) :
+        m_filter(filter)
+    { }
+
+    Error write(const char *data, qint64 size)
+    { return put(data, size, false); }
+
+    Error close()
+    { return put(0, 0, true); }
+};
+
+}
+
+#endif // QRYPTO_CRYPTOPP_FILTER_H
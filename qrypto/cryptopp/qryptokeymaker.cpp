@@ -1,8 +1,19 @@
 #include "../qryptokeymaker.h"
 
+#include "../qryptomemoryhard.h"
+#include "../qryptopbkdf2.h"
+#include "../qryptosink.h"
+
+#include <QAtomicInt>
 #include <QScopedPointer>
+#include <QThread>
+#include <QVector>
+#include <QtConcurrentMap>
 
 #include <cryptopp/cryptlib.h>
+#include <cryptopp/hrtimer.h>
+#include <cryptopp/hmac.h>
+#include <cryptopp/misc.h>
 #include <cryptopp/osrng.h>
 #include <cryptopp/pwdbased.h>
 #include <cryptopp/ripemd.h>
@@ -11,9 +22,175 @@
 #include <cryptopp/tiger.h>
 #include <cryptopp/whrlpool.h>
 
+#include <cstring>
+
 namespace Qrypto
 {
 
+class HMACSink : public Sink
+{
+    KeyMaker::Hmac m_hmac;
+    QByteArray &m_code;
+    uint m_truncatedSize;
+
+public:
+    HMACSink(QByteArray &code, uint truncatedSize) :
+        m_code(code),
+        m_truncatedSize(truncatedSize)
+    { }
+
+    bool init(const KeyMaker &keyMaker)
+    { return m_hmac.init(keyMaker); }
+
+    Error write(const char *data, qint64 size)
+    {
+        if (size > 0)
+            m_hmac.update(data, quint64(size));
+
+        return NoError;
+    }
+
+    Error close()
+    {
+        m_code = m_hmac.final(m_truncatedSize);
+        return NoError;
+    }
+};
+
+/**
+ * @brief The Pbkdf2 struct computes the independent blocks of PBKDF2-HMAC on threads of the pool,
+ * bit for bit like CryptoPP::PKCS5_PBKDF2_HMAC
+ * @note in timed mode the first block decides the iteration count, as in CryptoPP,
+ * the others never run past the iteration it has reached
+ */
+template <class Alg>
+struct Pbkdf2
+{
+    typedef void result_type;
+
+    /**
+     * @brief The Block struct is a digest-sized part of the derived key
+     */
+    struct Block
+    {
+        uint index;
+        CryptoPP::byte *derived;
+        size_t size;
+    };
+
+    const CryptoPP::byte *password;
+    size_t passwordSize;
+    const CryptoPP::byte *salt;
+    size_t saltSize;
+    uint iterations;
+    double timeInSeconds;
+    QAtomicInt *progress; ///< boundary the first block went past
+    QAtomicInt *stop; ///< iteration count decided by the first block, 0 until then
+
+    void operator()(const Block &block) const
+    { iterate(block, false); }
+
+    /**
+     * @return iteration count
+     */
+    uint iterate(const Block &block, bool leader) const
+    {
+        CryptoPP::HMAC<Alg> hmac(password, passwordSize);
+        CryptoPP::SecByteBlock buffer(hmac.DigestSize());
+        CryptoPP::ThreadUserTimer timer;
+        const CryptoPP::byte counter[4] = {
+            CryptoPP::byte(block.index >> 24), CryptoPP::byte(block.index >> 16),
+            CryptoPP::byte(block.index >> 8), CryptoPP::byte(block.index)
+        };
+        uint j;
+
+        hmac.Update(salt, saltSize);
+        hmac.Update(counter, sizeof counter);
+        hmac.Final(buffer);
+        std::memcpy(block.derived, buffer, block.size);
+
+        if (leader && timeInSeconds > 0)
+            timer.StartTimer();
+
+        for (j = 1; proceed(j, leader, timer); ++j) {
+            hmac.Update(buffer, buffer.size());
+            hmac.Final(buffer);
+            CryptoPP::xorbuf(block.derived, buffer, block.size);
+        }
+
+        return j;
+    }
+
+    bool proceed(uint j, bool leader, CryptoPP::ThreadUserTimer &timer) const
+    {
+        if (j < iterations)
+            return true;
+        else if (timeInSeconds <= 0)
+            return false;
+        else if (j % 128)
+            return true; // like CryptoPP, the time is checked every 128 iterations
+
+        if (leader && timer.ElapsedTimeAsDouble() >= timeInSeconds) {
+            stop->storeRelease(int(j));
+            return false;
+        } else if (leader) {
+            progress->storeRelease(int(j));
+            return true;
+        }
+
+        while (!stop->loadAcquire() && uint(progress->loadAcquire()) < j)
+            QThread::yieldCurrentThread(); // ahead of the first block
+
+        return uint(stop->loadAcquire()) != j;
+    }
+
+    /**
+     * @brief derive fills derived with blocks from index 1
+     * @param timeInSeconds of wall clock for all blocks, 0 for a fixed iteration count
+     * @return iteration count
+     */
+    uint derive(CryptoPP::byte *derived, size_t derivedSize, uint iterationCount, double time)
+    {
+        const size_t digestSize = Alg::DIGESTSIZE;
+        const int threads = qMax(QThread::idealThreadCount(), 1);
+        QVector<Block> blocks;
+        QAtomicInt progressed(0);
+        QAtomicInt stopped(0);
+
+        for (size_t offset = 0; offset < derivedSize; offset += digestSize) {
+            Block block;
+            block.index = uint(blocks.size() + 1);
+            block.derived = derived + offset;
+            block.size = qMin(digestSize, derivedSize - offset);
+            blocks.append(block);
+        }
+
+        if (blocks.isEmpty())
+            return iterationCount;
+
+        iterations = qMax(iterationCount, 1U);
+        timeInSeconds = time / ((blocks.size() + threads - 1) / threads); // rounds of blocks on all threads
+        progress = &progressed;
+        stop = &stopped;
+
+        if (timeInSeconds <= 0) {
+            QtConcurrent::blockingMap(blocks, *this);
+            return iterations;
+        }
+
+        const Block first = blocks.takeFirst();
+        QFuture<void> others = QtConcurrent::map(blocks, *this); // they wait for this thread, never the reverse
+        const uint count = iterate(first, true);
+        others.waitForFinished();
+        return count;
+    }
+};
+
+struct KeyMaker::Hmac::Impl
+{
+    QScopedPointer<CryptoPP::MessageAuthenticationCode> hmac;
+};
+
 struct KeyMaker::Impl
 {
     KeyMaker *q;
@@ -57,41 +234,121 @@ struct KeyMaker::Impl
         }
     }
 
+    /**
+     * @brief prepare resizes the key and generates a salt if it is unusable
+     */
     template <class Alg>
-    Error deriveKey(const char *pwData, uint pwSize, size_t keyLength) const
+    void prepare(size_t keyLength) const
     {
         CryptoPP::PKCS5_PBKDF2_HMAC<Alg> PBKDF;
 
-        try {
-            q->m_key.resize(std::min(keyLength, PBKDF.MaxDerivedKeyLength()));
+        q->m_key.resize(std::min(keyLength, PBKDF.MaxDerivedKeyLength()));
+        prepareSalt(Alg::DIGESTSIZE / 2);
+    }
 
-            if (q->m_salt.isEmpty())
-                q->m_salt.fill('\0', Alg::DIGESTSIZE / 2); // using resize seems to optimise out the count
+    void prepareSalt(int saltSize) const
+    {
+        if (q->m_salt.isEmpty())
+            q->m_salt.fill('\0', saltSize); // using resize seems to optimise out the count
 
-            if (q->m_salt.count('\0') == q->m_salt.size()) {
-                CryptoPP::AutoSeededRandomPool prng;
+        if (q->m_salt.count('\0') == q->m_salt.size()) {
+            CryptoPP::AutoSeededRandomPool prng;
 
-                for (int zeroes = q->m_salt.size(), half = zeroes / 2; zeroes > half; zeroes = q->m_salt.count('\0'))
-                    prng.GenerateBlock(reinterpret_cast<CryptoPP::byte*>(q->m_salt.data()), q->m_salt.size());
-            }
+            for (int zeroes = q->m_salt.size(), half = zeroes / 2; zeroes > half; zeroes = q->m_salt.count('\0'))
+                prng.GenerateBlock(reinterpret_cast<CryptoPP::byte*>(q->m_salt.data()), q->m_salt.size());
+        }
+    }
 
-            q->m_iteration = PBKDF.DeriveKey(q->m_key->data(), q->m_key->size(), 0,
-                                             reinterpret_cast<const CryptoPP::byte*>(pwData), pwSize,
-                                             reinterpret_cast<const CryptoPP::byte*>(q->m_salt.constData()), q->m_salt.size(),
-                                             q->m_iteration, q->m_iterationTime / 1000.0);
+    static Error error(const CryptoPP::Exception &exc)
+    {
+        qCritical("%s", exc.what());
+
+        switch (exc.GetErrorType()) {
+        case CryptoPP::Exception::INVALID_ARGUMENT:
+            return InvalidArgument;
+        default:
+            return UnknownError;
+        }
+    }
+
+    template <class Alg>
+    Error deriveKey(const char *pwData, uint pwSize, size_t keyLength) const
+    {
+        Pbkdf2<Alg> pbkdf2;
+
+        try {
+            prepare<Alg>(keyLength);
+            pbkdf2.password = reinterpret_cast<const CryptoPP::byte*>(pwData);
+            pbkdf2.passwordSize = pwSize;
+            pbkdf2.salt = reinterpret_cast<const CryptoPP::byte*>(q->m_salt.constData());
+            pbkdf2.saltSize = size_t(q->m_salt.size());
+            q->m_iteration = pbkdf2.derive(q->m_key.data(), q->m_key.size(), q->m_iteration, q->m_iterationTime / 1000.0);
 
             return NoError;
         } catch (const std::bad_alloc &exc) {
             return OutOfMemory;
         } catch (const CryptoPP::Exception &exc) {
-            qCritical("%s", exc.what());
+            return error(exc);
+        }
+    }
 
-            switch (exc.GetErrorType()) {
-            case CryptoPP::Exception::INVALID_ARGUMENT:
-                return InvalidArgument;
-            default:
-                return UnknownError;
+    /**
+     * @brief deriveMemoryHard generates the key with Argon2id or scrypt, ignoring the iterationTime
+     */
+    Error deriveMemoryHard(const char *pwData, uint pwSize, size_t keyLength) const
+    {
+        const uint lanes = qMax(q->m_parallelism, 1U);
+        quint64 cost = 2;
+        bool derived;
+
+        try {
+            q->m_key.resize(keyLength);
+            prepareSalt(16);
+
+            if (q->function() == Argon2id) {
+                derived = MemoryHard::argon2id(q->m_key.data(), q->m_key.size(), pwData, pwSize,
+                                               q->m_salt.constData(), size_t(q->m_salt.size()),
+                                               q->m_iteration, q->m_memoryCost, lanes);
+            } else {
+                while (cost * 2 <= q->m_memoryCost / lanes)
+                    cost *= 2; // blocks of 1 KiB with r = 8
+
+                derived = MemoryHard::scrypt(q->m_key.data(), q->m_key.size(), pwData, pwSize,
+                                             q->m_salt.constData(), size_t(q->m_salt.size()), cost, 8, lanes);
             }
+
+            return derived ? NoError : InvalidArgument;
+        } catch (const std::bad_alloc &exc) {
+            return OutOfMemory;
+        } catch (const CryptoPP::Exception &exc) {
+            return error(exc);
+        }
+    }
+
+    /**
+     * @brief prepare a job of MultiPbkdf2 for a fixed iteration count
+     */
+    template <class Alg>
+    Error prepareJob(MultiPbkdf2::Job &job, MultiPbkdf2::Hash hash, const char *pwData, uint pwSize,
+                     size_t keyLength) const
+    {
+        try {
+            prepare<Alg>(keyLength);
+            q->m_iteration = qMax(q->m_iteration, 1U);
+            job.hash = hash;
+            job.password = pwData;
+            job.passwordSize = pwSize;
+            job.salt = q->m_salt.constData();
+            job.saltSize = size_t(q->m_salt.size());
+            job.iterations = q->m_iteration;
+            job.derived = q->m_key.data();
+            job.derivedSize = q->m_key.size();
+
+            return NoError;
+        } catch (const std::bad_alloc &exc) {
+            return OutOfMemory;
+        } catch (const CryptoPP::Exception &exc) {
+            return error(exc);
         }
     }
 };
@@ -116,7 +373,13 @@ const QStringList KeyMaker::AlgorithmNames =
                          CryptoPP::Whirlpool::StaticAlgorithmName() <<
                          QString();
 
-QByteArray KeyMaker::authenticate(const char *messageData, uint messageSize, uint truncatedSize) const
+const QStringList KeyMaker::FunctionNames =
+        QStringList() << QLatin1String("PBKDF2") <<
+                         QLatin1String("Argon2id") <<
+                         QLatin1String("scrypt") <<
+                         QString();
+
+QByteArray KeyMaker::authenticate(const char *messageData, quint64 messageSize, uint truncatedSize) const
 {
     QScopedPointer<CryptoPP::MessageAuthenticationCode> HMAC(Impl::getHMAC(this));
     QByteArray code;
@@ -125,10 +388,66 @@ QByteArray KeyMaker::authenticate(const char *messageData, uint messageSize, uin
         if (0 < truncatedSize && truncatedSize < HMAC->DigestSize())
             HMAC->CalculateTruncatedDigest(reinterpret_cast<CryptoPP::byte*>(code.fill(0, truncatedSize).data()),
                                            truncatedSize, reinterpret_cast<const CryptoPP::byte*>(messageData),
-                                           messageSize);
+                                           size_t(messageSize));
         else
             HMAC->CalculateDigest(reinterpret_cast<CryptoPP::byte*>(code.fill(0, HMAC->DigestSize()).data()),
-                                  reinterpret_cast<const CryptoPP::byte*>(messageData), messageSize);
+                                  reinterpret_cast<const CryptoPP::byte*>(messageData), size_t(messageSize));
+    }
+
+    return code;
+}
+
+uint KeyMaker::digestSize() const
+{
+    const KeyMaker probe(algorithm(), 1); // the HMAC needs a key, any will do
+    QScopedPointer<CryptoPP::MessageAuthenticationCode> HMAC(Impl::getHMAC(&probe));
+
+    return HMAC ? HMAC->DigestSize() : 0;
+}
+
+Sink *KeyMaker::authenticator(QByteArray &code, uint truncatedSize) const
+{
+    QScopedPointer<HMACSink> sink(new HMACSink(code, truncatedSize));
+
+    code.clear();
+    return sink->init(*this) ? sink.take() : 0;
+}
+
+KeyMaker::Hmac::Hmac() :
+    d(new Impl)
+{ }
+
+KeyMaker::Hmac::~Hmac()
+{
+    delete d;
+}
+
+bool KeyMaker::Hmac::init(const KeyMaker &keyMaker)
+{
+    d->hmac.reset(KeyMaker::Impl::getHMAC(&keyMaker));
+    return !d->hmac.isNull();
+}
+
+bool KeyMaker::Hmac::isValid() const
+{
+    return !d->hmac.isNull();
+}
+
+void KeyMaker::Hmac::update(const char *data, quint64 size)
+{
+    if (d->hmac && size > 0)
+        d->hmac->Update(reinterpret_cast<const CryptoPP::byte*>(data), size_t(size));
+}
+
+QByteArray KeyMaker::Hmac::final(uint truncatedSize)
+{
+    QByteArray code;
+
+    if (d->hmac) {
+        const uint size = 0 < truncatedSize && truncatedSize < d->hmac->DigestSize()
+                ? truncatedSize : d->hmac->DigestSize();
+
+        d->hmac->TruncatedFinal(reinterpret_cast<CryptoPP::byte*>(code.fill(0, size).data()), size);
     }
 
     return code;
@@ -140,13 +459,23 @@ Error KeyMaker::deriveKey(const char *passwordData, uint passwordSize, uint keyL
         return IntegrityError;
 
     if (!keyLength)
-        keyLength = m_key->size();
+        keyLength = m_key.size();
 
     if (!keyLength)
         return InvalidArgument;
 
     const Impl f(this);
 
+    switch (function()) {
+    case Pbkdf2:
+        break;
+    case Argon2id:
+    case Scrypt:
+        return f.deriveMemoryHard(passwordData, passwordSize, keyLength);
+    default:
+        return NotImplemented;
+    }
+
     switch (algorithm()) {
     case RipeMD_160:
         return f.deriveKey<CryptoPP::RIPEMD160>(passwordData, passwordSize, keyLength);
@@ -178,3 +507,58 @@ Error KeyMaker::deriveKey(const char *passwordData, uint passwordSize, uint keyL
         return NotImplemented;
     }
 }
+
+void KeyMaker::deriveKeys(QVector<Derivation> &batch)
+{
+    QVector<MultiPbkdf2::Job> jobs;
+
+    for (int i = 0; i < batch.size(); ++i) {
+        Derivation &derivation = batch[i];
+        KeyMaker *keyMaker = derivation.keyMaker;
+        const uint keyLength = derivation.keyLength ? derivation.keyLength : keyMaker ? keyMaker->keyLength() : 0;
+        const Impl f(keyMaker);
+        MultiPbkdf2::Job job;
+
+        if (!keyMaker || !derivation.passwordData || !derivation.passwordSize) {
+            derivation.error = IntegrityError;
+            continue;
+        } else if (!keyLength) {
+            derivation.error = InvalidArgument;
+            continue;
+        } else if (keyMaker->m_iterationTime || keyMaker->function() != Pbkdf2) {
+            derivation.error = keyMaker->deriveKey(derivation.passwordData, derivation.passwordSize, keyLength);
+            continue;
+        }
+
+        switch (keyMaker->algorithm()) {
+        case Sha1:
+            derivation.error = f.prepareJob<CryptoPP::SHA1>(job, MultiPbkdf2::Sha1, derivation.passwordData,
+                                                            derivation.passwordSize, keyLength);
+            break;
+        case Sha224:
+            derivation.error = f.prepareJob<CryptoPP::SHA224>(job, MultiPbkdf2::Sha224, derivation.passwordData,
+                                                              derivation.passwordSize, keyLength);
+            break;
+        case Sha256:
+            derivation.error = f.prepareJob<CryptoPP::SHA256>(job, MultiPbkdf2::Sha256, derivation.passwordData,
+                                                              derivation.passwordSize, keyLength);
+            break;
+        case Sha384:
+            derivation.error = f.prepareJob<CryptoPP::SHA384>(job, MultiPbkdf2::Sha384, derivation.passwordData,
+                                                              derivation.passwordSize, keyLength);
+            break;
+        case Sha512:
+            derivation.error = f.prepareJob<CryptoPP::SHA512>(job, MultiPbkdf2::Sha512, derivation.passwordData,
+                                                              derivation.passwordSize, keyLength);
+            break;
+        default:
+            derivation.error = keyMaker->deriveKey(derivation.passwordData, derivation.passwordSize, keyLength);
+            continue;
+        }
+
+        if (derivation.error == NoError)
+            jobs.append(job);
+    }
+
+    MultiPbkdf2::derive(jobs.constData(), jobs.size());
+}
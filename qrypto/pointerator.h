@@ -12,12 +12,17 @@
 #ifndef QRYPTO_POINTERATOR_H
 #define QRYPTO_POINTERATOR_H
 
+#include <QThread>
+#include <QVector>
+#include <QtConcurrentMap>
+
 #include <algorithm>
+#include <cstddef>
 
 namespace Qrypto
 {
 
-template <typename T, unsigned Chunk = 65536U / sizeof(T)>
+template <typename T, size_t Chunk = 65536U / sizeof(T)>
 /**
  * @brief The Pointerator class iterates through chunks of memory
  * @param T can be either const or non-const pointer, this class doesn't care
@@ -26,17 +31,26 @@ template <typename T, unsigned Chunk = 65536U / sizeof(T)>
 class Pointerator
 {
     T *d;
-    unsigned i;
-    unsigned s;
+    size_t i;
+    size_t s;
+
+    static size_t gcd(size_t a, size_t b)
+    { return b ? gcd(b, a % b) : a; }
 
 public:
 
+    /// cache line size in bytes, parallel chunks start on multiples of it
+    static const size_t CacheLine = 64;
+
+    /// default size of parallel chunks, sized to stay within a typical L2 cache
+    static const size_t ParallelChunk = 262144U / sizeof(T);
+
     /**
      * @brief Pointerator
      * @param data pointer to first element
      * @param size data element (total)
      */
-    Pointerator(T *data = 0, unsigned size = 0) :
+    Pointerator(T *data = 0, size_t size = 0) :
         d(data),
         i(0),
         s(size)
@@ -44,8 +58,8 @@ public:
 
     /* Vector-like accessor API */
 
-    T &at(unsigned id) const
-    { return d[std::min(std::max(0U, i + id), s)]; }
+    T &at(size_t id) const
+    { return d[std::min(i + id, s)]; }
 
     T *data() const
     { return d + i; }
@@ -56,7 +70,7 @@ public:
     bool isNull() const
     { return !d; }
 
-    unsigned size() const
+    size_t size() const
     { return s; }
 
     /* Citerator-like API
@@ -93,7 +107,7 @@ public:
 
     const_iterator &operator--()
     {
-        i = std::max(0U, i - Chunk);
+        i -= std::min(i, Chunk);
         return *this;
     }
 
@@ -118,16 +132,16 @@ public:
     bool atEnd() const
     { return i == s; }
 
-    unsigned bytesAvailable() const
+    size_t bytesAvailable() const
     { return (s - i) * sizeof(T); }
 
-    Pointerator<T, Chunk> peek(unsigned maxlength = Chunk) const
-    { return Pointerator<T, Chunk>(data(), std::min(i + maxlength, s) - i); }
+    Pointerator<T, Chunk> peek(size_t maxlength = Chunk) const
+    { return Pointerator<T, Chunk>(data(), std::min(maxlength, s - i)); }
 
-    unsigned pos() const
+    size_t pos() const
     { return i; }
 
-    Pointerator<T, Chunk> read(unsigned maxlength = Chunk)
+    Pointerator<T, Chunk> read(size_t maxlength = Chunk)
     {
         const Pointerator<T, Chunk> chunk(peek(maxlength));
         i += chunk.size();
@@ -137,11 +151,57 @@ public:
     Pointerator<T, Chunk> &reset()
     { return seek(0); }
 
-    Pointerator<T, Chunk> &seek(unsigned offset)
+    Pointerator<T, Chunk> &seek(size_t offset)
     {
-        i = std::min(std::max(0U, offset), s);
+        i = std::min(offset, s);
         return *this;
     }
+
+    /* Parallel API
+     * struct Function { typedef void result_type; void operator()(Pointerator<T, Chunk> &chunk) const; };
+     * Pointerator<T>(data, size).parallelForEachChunk(Function(), 0, blockSize);
+     */
+
+    /**
+     * @brief chunks splits the remaining elements in slices of at least one chunk per thread
+     * @param chunk size in elements, ParallelChunk if zero
+     * @param alignment in elements of every boundary, such as a cipher block
+     * @return chunks as multiples of both the alignment and the CacheLine, but the last one
+     */
+    QVector<Pointerator<T, Chunk> > chunks(size_t chunk = 0, size_t alignment = 1) const
+    {
+        const size_t line = std::max<size_t>(CacheLine / sizeof(T), 1);
+        const size_t block = std::max<size_t>(alignment, 1);
+        const size_t unit = block / gcd(block, line) * line;
+        const size_t size = std::max(chunk ? chunk : size_t(ParallelChunk), unit) / unit * unit;
+        QVector<Pointerator<T, Chunk> > slices;
+        slices.reserve(int((s - i + size - 1) / size));
+
+        for (Pointerator<T, Chunk> it(data(), s - i); !it.atEnd(); )
+            slices.append(it.read(size));
+
+        return slices;
+    }
+
+    /**
+     * @brief parallelForEachChunk maps function over the chunks on the global thread pool
+     * and blocks until all of them are done, serially on a single core
+     * @param function taking a Pointerator<T, Chunk> reference, in no particular order
+     * @param chunk size in elements, ParallelChunk if zero
+     * @param alignment in elements of every boundary, such as a cipher block
+     */
+    template <class Function>
+    void parallelForEachChunk(Function function, size_t chunk = 0, size_t alignment = 1) const
+    {
+        QVector<Pointerator<T, Chunk> > slices(chunks(chunk, alignment));
+
+        if (slices.size() > 1 && QThread::idealThreadCount() > 1) {
+            QtConcurrent::blockingMap(slices, function);
+        } else {
+            for (int slice = 0; slice < slices.size(); ++slice)
+                function(slices[slice]);
+        }
+    }
 };
 
 }
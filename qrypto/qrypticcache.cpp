@@ -0,0 +1,158 @@
+#include "qrypticcache.h"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QSaveFile>
+
+namespace
+{
+const quint32 Magic = 0x51435843; // QCXC
+const qint32 Version = 1;
+
+/**
+ * @brief The Entry struct holds the raw sections of one cryptic file
+ */
+struct Entry
+{
+    qint64 size;
+    qint64 modified;
+    qint32 version;
+    QByteArray header;
+    QByteArray trailer;
+
+    Entry() :
+        size(-1),
+        modified(0),
+        version(0)
+    { }
+
+    bool matches(const QFileInfo &info) const
+    { return size == info.size() && modified == info.lastModified().toMSecsSinceEpoch(); }
+};
+
+QDataStream &operator<<(QDataStream &out, const Entry &entry)
+{
+    return out << entry.size << entry.modified << entry.version << entry.header << entry.trailer;
+}
+
+QDataStream &operator>>(QDataStream &in, Entry &entry)
+{
+    return in >> entry.size >> entry.modified >> entry.version >> entry.header >> entry.trailer;
+}
+}
+
+struct QryptCache::Private
+{
+    QMutex mutex;
+    QString fileName;
+    QHash<QString, Entry> entries;
+    bool modified;
+
+    Private(const QString &fileName) :
+        fileName(fileName),
+        modified(false)
+    { }
+};
+
+QryptCache::QryptCache(const QString &fileName) :
+    d(new Private(fileName))
+{
+    QFile file(fileName);
+
+    if (file.open(QIODevice::ReadOnly)) {
+        QDataStream in(&file);
+        quint32 magic;
+        qint32 version;
+        in.setVersion(QDataStream::Qt_5_0);
+        in >> magic >> version;
+
+        if (magic == Magic && version == Version)
+            in >> d->entries;
+
+        if (in.status() != QDataStream::Ok)
+            d->entries.clear();
+    }
+}
+
+QryptCache::~QryptCache()
+{
+    if (d->modified)
+        save();
+
+    delete d;
+}
+
+QryptIO::Status QryptCache::read(QryptIO &io)
+{
+    QFile *file = qobject_cast<QFile*>(io.device());
+    QryptIO::Status status;
+
+    if (!file) {
+        status = io.readHeader();
+        return status == QryptIO::Ok ? io.readTrailer() : status;
+    }
+
+    const QFileInfo info(*file);
+    const QString path = info.absoluteFilePath();
+    QMutexLocker locker(&d->mutex);
+    const Entry cached = d->entries.value(path);
+    locker.unlock();
+
+    if (cached.matches(info))
+        return io.setMetadata(cached.version, cached.header, cached.trailer);
+
+    status = io.readHeader();
+
+    if (status == QryptIO::Ok)
+        status = io.readTrailer();
+
+    if (status == QryptIO::Ok) {
+        Entry entry;
+        int version;
+        entry.size = info.size();
+        entry.modified = info.lastModified().toMSecsSinceEpoch();
+        io.metadata(version, entry.header, entry.trailer);
+        entry.version = version;
+        locker.relock();
+        d->entries.insert(path, entry);
+        d->modified = true;
+    }
+
+    return status;
+}
+
+void QryptCache::remove(const QString &path)
+{
+    QMutexLocker locker(&d->mutex);
+    d->modified = d->entries.remove(QFileInfo(path).absoluteFilePath()) > 0 || d->modified;
+}
+
+void QryptCache::clear()
+{
+    QMutexLocker locker(&d->mutex);
+    d->modified = d->modified || !d->entries.isEmpty();
+    d->entries.clear();
+}
+
+bool QryptCache::save()
+{
+    QMutexLocker locker(&d->mutex);
+    QSaveFile file(d->fileName);
+
+    if (!file.open(QIODevice::WriteOnly))
+        return false;
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_0);
+    out << Magic << Version << d->entries;
+
+    if (out.status() != QDataStream::Ok || !file.commit())
+        return false;
+
+    d->modified = false;
+    return true;
+}
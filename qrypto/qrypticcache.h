@@ -0,0 +1,66 @@
+/* Qrypto 2019
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**/
+#ifndef QRYPTICCACHE_H
+#define QRYPTICCACHE_H
+
+#include "qrypticstream.h"
+
+#include <QString>
+
+/**
+ * @brief The QryptCache class keeps the Header and Trailer of cryptic files on disk,
+ * keyed by path, size and modification time, so catalogs need not read the files again
+ * @note thread-safe, salts and initial vectors are stored, never keys or plain data
+ */
+class QryptCache
+{
+    struct Private;
+    Private *d;
+
+    Q_DISABLE_COPY(QryptCache)
+
+public:
+    /**
+     * @brief QryptCache loads the entries saved in fileName, if any
+     * @param fileName
+     */
+    explicit QryptCache(const QString &fileName);
+
+    /**
+     * @brief ~QryptCache saves the entries if they changed
+     */
+    ~QryptCache();
+
+    /**
+     * @brief read the Header and Trailer into io, from the cache while its file is unchanged
+     * @param io on a QFile, other devices are read without the cache
+     * @return status of QryptIO::readHeader and QryptIO::readTrailer
+     * @note on a hit the file is not opened, only its size and modification time are queried
+     */
+    QryptIO::Status read(QryptIO &io);
+
+    /**
+     * @brief remove the entry of path
+     * @param path
+     */
+    void remove(const QString &path);
+
+    void clear();
+
+    /**
+     * @brief save the entries into fileName atomically
+     * @return false if the file could not be written
+     */
+    bool save();
+};
+
+#endif // QRYPTICCACHE_H
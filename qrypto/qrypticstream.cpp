@@ -1,23 +1,531 @@
 #include "qrypticstream.h"
 
-#include <QXmlStreamReader>
+#include <QBuffer>
+#include <QFile>
+#include <QScopedPointer>
+#include <QThread>
+#include <QVector>
 #include <QXmlStreamWriter>
+#include <QtConcurrentMap>
+
+#include <cstring>
+#include <limits>
 
 #include "pointerator.h"
 #include "qryptocipher.h"
 #include "qryptocompress.h"
+#include "qryptoencoding.h"
 #include "qryptokeymaker.h"
+#include "qryptosink.h"
 #include "sequre.h"
 
+/**
+ * @brief The Der struct encodes the Cryptic V3 element hierarchy in ASN.1 DER
+ * @note streamed documents use BER indefinite lengths for Cryptic and Payload
+ */
+struct Der
+{
+    enum Tag {
+        EndOfContents = 0x00,
+        Integer = 0x02,
+        OctetString = 0x04,
+        Utf8String = 0x0C,
+        Sequence = 0x30,
+        Constructed = 0x20,
+        Context = 0x80
+    };
+
+    static const qint64 Indefinite = -1;
+
+    static QByteArray header(uchar tag, qint64 length)
+    {
+        QByteArray der(1, char(tag));
+
+        if (length == Indefinite) {
+            der += char(0x80);
+        } else if (length < 0x80) {
+            der += char(length);
+        } else {
+            int size = 0;
+
+            for (qint64 l = length; l; l >>= 8)
+                ++size;
+
+            der += char(0x80 | size);
+
+            while (size-- > 0)
+                der += char(length >> (size * 8));
+        }
+
+        return der;
+    }
+
+    static QByteArray encode(uchar tag, const QByteArray &content)
+    { return header(tag, content.size()) + content; }
+
+    static QByteArray integer(qint64 value, uchar tag = Integer)
+    {
+        QByteArray content;
+
+        do {
+            content.prepend(char(value));
+            value >>= 8;
+        } while (value > 0 || value < -1);
+
+        if (bool(content.at(0) & 0x80) != (value < 0))
+            content.prepend(char(value)); // two's complement sign octet
+
+        return encode(tag, content);
+    }
+
+    static qint64 toInteger(const QByteArray &content)
+    {
+        qint64 value = !content.isEmpty() && content.at(0) & 0x80 ? -1 : 0;
+
+        foreach (const char c, content)
+            value = (value << 8) | uchar(c);
+
+        return value;
+    }
+
+    static QByteArray endOfContents()
+    { return QByteArray(2, '\0'); }
+
+    /**
+     * @brief read tag and length octets
+     * @return false at the end or on malformed octets
+     */
+    static bool readHeader(QIODevice *device, uchar &tag, qint64 &length)
+    {
+        char c;
+
+        if (!device->getChar(&c))
+            return false;
+
+        tag = c;
+
+        if (!device->getChar(&c))
+            return false;
+
+        if (uchar(c) == 0x80) {
+            length = Indefinite;
+        } else if (uchar(c) < 0x80) {
+            length = uchar(c);
+        } else {
+            length = 0;
+
+            for (int size = c & 0x7F; size > 0; --size) {
+                if (size > 8 || !device->getChar(&c))
+                    return false;
+
+                length = (length << 8) | uchar(c);
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief read a whole element of definite length
+     */
+    static bool read(QIODevice *device, uchar &tag, QByteArray &content)
+    {
+        qint64 length;
+
+        if (!readHeader(device, tag, length) || length < 0 || length > device->bytesAvailable())
+            return false;
+
+        content = device->read(length);
+        return content.size() == length;
+    }
+
+    /**
+     * @brief version of the Cryptic document in data
+     * @return 0 if data is not a DER Cryptic document
+     */
+    static int version(const QByteArray &data)
+    {
+        QBuffer buffer;
+        QByteArray content;
+        qint64 length;
+        uchar tag;
+        buffer.setData(data);
+        buffer.open(QIODevice::ReadOnly);
+
+        if (readHeader(&buffer, tag, length) && tag == Sequence &&
+                read(&buffer, tag, content) && tag == Integer && content.size() == 1)
+            return content.at(0);
+
+        return 0;
+    }
+};
+
+/**
+ * @brief The Xml struct tokenises Cryptic V1 and V2 documents straight from the bytes of the device
+ * @note covers what the Cryptic schemas use: prolog, comments, CDATA, attributes,
+ * predefined and character entities, but no entities declared in a DTD
+ */
+struct Xml
+{
+    enum Token {
+        Invalid,
+        StartElement,
+        EndElement,
+        EndDocument
+    };
+
+    static const int ChunkSize = 65536;
+
+    QIODevice *device;
+    QByteArray buffer;
+    int pos;
+    QByteArray name;
+    QByteArray attributes;
+    bool empty;
+    bool characters;
+
+    Xml(QIODevice *device) :
+        device(device),
+        pos(0),
+        empty(false),
+        characters(false)
+    { }
+
+    Xml(const QByteArray &data) :
+        device(0),
+        buffer(data),
+        pos(0),
+        empty(false),
+        characters(false)
+    { }
+
+    /**
+     * @brief fill reads another chunk of the device after the unread bytes
+     * @return false at the end of the device
+     */
+    bool fill()
+    {
+        if (!device)
+            return false;
+
+        buffer.remove(0, pos);
+        pos = 0;
+        const int size = buffer.size();
+        buffer.resize(size + ChunkSize);
+        const qint64 read = device->read(buffer.data() + size, ChunkSize);
+        buffer.resize(size + int(qMax<qint64>(read, 0)));
+        return read > 0;
+    }
+
+    /**
+     * @brief available ensures size bytes can be read from pos
+     */
+    bool available(int size)
+    {
+        while (buffer.size() - pos < size) {
+            if (!fill())
+                return false;
+        }
+
+        return true;
+    }
+
+    bool at(const char *markup)
+    {
+        const int size = int(qstrlen(markup));
+        return available(size) && qstrncmp(buffer.constData() + pos, markup, size) == 0;
+    }
+
+    /**
+     * @brief find the offset of markup from pos
+     * @return -1 if the document ends first
+     */
+    int find(const char *markup)
+    {
+        const int size = int(qstrlen(markup));
+
+        for (int from = 0; ; ) {
+            const int offset = buffer.indexOf(markup, pos + from);
+
+            if (offset >= 0)
+                return offset - pos;
+
+            from = qMax(0, buffer.size() - pos - size + 1);
+
+            if (!fill())
+                return -1;
+        }
+    }
+
+    /**
+     * @brief skip past the end of markup
+     */
+    bool skip(const char *markup)
+    {
+        const int offset = find(markup);
+        pos += offset + int(qstrlen(markup));
+        return offset >= 0;
+    }
+
+    /**
+     * @brief tagSize up to and including the closing bracket, quoted values may contain one
+     * @return -1 if the document ends first
+     */
+    int tagSize()
+    {
+        char quote = 0;
+
+        for (int offset = 1; ; ++offset) {
+            if (!available(offset + 1))
+                return -1;
+
+            const char c = buffer.at(pos + offset);
+
+            if (quote)
+                quote = c == quote ? 0 : quote;
+            else if (c == '"' || c == '\'')
+                quote = c;
+            else if (c == '>')
+                return offset + 1;
+        }
+    }
+
+    /**
+     * @brief readNext skips prolog, comments and characters between elements
+     */
+    Token readNext()
+    {
+        for (;;) {
+            const int offset = find("<");
+
+            if (offset < 0)
+                return EndDocument;
+
+            for (const char *c = buffer.constData() + pos, *end = c + offset; c != end && !characters; ++c)
+                characters = !isSpace(*c);
+
+            pos += offset;
+
+            if (at("<?")) {
+                if (!skip("?>"))
+                    return Invalid;
+            } else if (at("<!--")) {
+                if (!skip("-->"))
+                    return Invalid;
+            } else if (at("<![CDATA[")) {
+                if (!skip("]]>"))
+                    return Invalid;
+
+                characters = true;
+            } else if (at("<!")) {
+                const int size = find(">");
+                const bool subset = size > 0 && memchr(buffer.constData() + pos, '[', size);
+
+                if (size < 0 || !skip(subset ? "]>" : ">"))
+                    return Invalid;
+            } else {
+                return readTag();
+            }
+        }
+    }
+
+    Token readTag()
+    {
+        const int size = tagSize();
+
+        if (size < 0)
+            return Invalid;
+
+        const char *tag = buffer.constData() + pos;
+        const bool end = tag[1] == '/';
+        int from = end ? 2 : 1;
+        int to = from;
+
+        while (to < size - 1 && !isSpace(tag[to]) && tag[to] != '/' && tag[to] != '>')
+            ++to;
+
+        empty = !end && tag[size - 2] == '/';
+
+        for (int colon = from; colon < to; ++colon) {
+            if (tag[colon] == ':')
+                from = colon + 1; // local name without prefix
+        }
+
+        name = QByteArray(tag + from, to - from);
+        attributes = end ? QByteArray() : QByteArray(tag + to, size - to - (empty ? 2 : 1));
+        pos += size;
+        return name.isEmpty() ? Invalid : end ? EndElement : StartElement;
+    }
+
+    /**
+     * @brief attribute value of the last start element, by local name
+     */
+    QByteArray attribute(const QByteArray &localName) const
+    {
+        for (int offset = 0; (offset = attributes.indexOf(localName, offset)) >= 0; offset += localName.size()) {
+            const char before = offset ? attributes.at(offset - 1) : ' ';
+            int equals = offset + localName.size();
+
+            if (!isSpace(before) && before != ':')
+                continue;
+
+            while (equals < attributes.size() && isSpace(attributes.at(equals)))
+                ++equals;
+
+            if (equals >= attributes.size() || attributes.at(equals) != '=')
+                continue;
+
+            int quote = equals + 1;
+
+            while (quote < attributes.size() && isSpace(attributes.at(quote)))
+                ++quote;
+
+            if (quote >= attributes.size() || (attributes.at(quote) != '"' && attributes.at(quote) != '\''))
+                continue;
+
+            const int close = attributes.indexOf(attributes.at(quote), quote + 1);
+
+            if (close > quote)
+                return attributes.mid(quote + 1, close - quote - 1);
+        }
+
+        return QByteArray();
+    }
+
+    /**
+     * @brief skipElement skips the contents and end of the last start element
+     */
+    bool skipElement()
+    {
+        for (int depth = empty ? 0 : 1; depth > 0; ) {
+            switch (readNext()) {
+            case StartElement:
+                depth += empty ? 0 : 1;
+                break;
+            case EndElement:
+                --depth;
+                break;
+            default:
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief readText appends the characters of the last start element up to its end
+     * @return false on a child element or at the end of the document
+     */
+    bool readText(QByteArray &text)
+    {
+        if (empty)
+            return true;
+
+        for (;;) {
+            const char *data = buffer.constData() + pos;
+            const char *end = buffer.constData() + buffer.size();
+            const char *markup = static_cast<const char*>(memchr(data, '<', end - data));
+            const char *entity = static_cast<const char*>(memchr(data, '&', (markup ? markup : end) - data));
+
+            if (entity) {
+                text.append(data, int(entity - data));
+                pos += int(entity - data);
+
+                if (!readEntity(text))
+                    return false;
+            } else if (!markup) {
+                text.append(data, int(end - data));
+                pos = buffer.size();
+
+                if (!fill())
+                    return false;
+            } else {
+                text.append(data, int(markup - data));
+                pos += int(markup - data);
+
+                if (at("<![CDATA[")) {
+                    const int size = (pos += 9, find("]]>"));
+
+                    if (size < 0)
+                        return false;
+
+                    text.append(buffer.constData() + pos, size);
+                    pos += size + 3;
+                } else if (at("<!--")) {
+                    if (!skip("-->"))
+                        return false;
+                } else if (at("<?")) {
+                    if (!skip("?>"))
+                        return false;
+                } else {
+                    return at("</") && readTag() == EndElement;
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief readEntity appends the character of a predefined or character reference
+     */
+    bool readEntity(QByteArray &text)
+    {
+        const int size = find(";");
+
+        if (size < 2 || size > 10)
+            return false;
+
+        const QByteArray reference(buffer.constData() + pos + 1, size - 1);
+        pos += size + 1;
+
+        if (reference == "lt")
+            text += '<';
+        else if (reference == "gt")
+            text += '>';
+        else if (reference == "amp")
+            text += '&';
+        else if (reference == "quot")
+            text += '"';
+        else if (reference == "apos")
+            text += '\'';
+        else if (reference.startsWith('#')) {
+            bool ok;
+            const uint code = reference.startsWith("#x") ? reference.mid(2).toUInt(&ok, 16) : reference.mid(1).toUInt(&ok);
+
+            if (!ok || code > 0x10FFFF)
+                return false;
+
+            const uint ucs4 = code;
+            text += QString::fromUcs4(&ucs4, 1).toUtf8();
+        } else {
+            return false;
+        }
+
+        return true;
+    }
+
+    static bool isSpace(char c)
+    { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+};
+
 struct QryptIO::Private
 {
-    static const QStringList CrypticV1;
-    static const QStringList CrypticV2;
+    struct Decryption;
+    struct Encryption;
+    static const int CrypticFields = 21;
+    static const char *const Cryptic[CrypticFields][2];
+    static const int ChunkSize = 65536;
+    static const int DataSize = 524288;
+    static const int HeaderSize = 4096;
     Qrypto::Error error;
     QryptIO::Status status;
     QIODevice *device;
     int crypticVersion;
+    qint64 length;
+    bool pipelined;
     QByteArray crypt;
+    QByteArray header; ///< raw Header section last loaded, for the QryptCache
+    QByteArray trailer; ///< raw Trailer section last loaded, for the QryptCache
     Qrypto::SequreBytes plain;
     Qrypto::Compress compress;
     Qrypto::Cipher cipher;
@@ -27,7 +535,9 @@ struct QryptIO::Private
         error(Qrypto::NoError),
         status(QryptIO::Ok),
         device(device),
-        crypticVersion(-1)
+        crypticVersion(-1),
+        length(0),
+        pipelined(false)
     { }
 
     bool isReadable()
@@ -35,117 +545,697 @@ struct QryptIO::Private
         return device && (device->isReadable() || device->open(QIODevice::ReadOnly)) && !device->atEnd();
     }
 
-    bool isWritable()
+    bool isWritable()
+    {
+        return device && (device->isWritable() || device->open(QIODevice::WriteOnly));
+    }
+
+    /**
+     * @brief mappable returns the device if it is a file that can be mapped into memory
+     */
+    QFile *mappable() const
+    {
+        QFile *file = qobject_cast<QFile*>(device);
+        return file && !file->isSequential() && file->size() > file->pos() ? file : 0;
+    }
+
+    bool decryptFile(QFile *file, Qrypto::SequreBytes &output, const Qrypto::SequreBytes &password);
+
+    /**
+     * @brief failure tells which stage of a stream raised the error
+     */
+    QryptIO::Status failure(const Qrypto::Sink *cipherStage, const Qrypto::Sink *compressStage) const
+    {
+        if (cipherStage && cipherStage->error())
+            return QryptIO::CryptographicError;
+        else if (compressStage && compressStage->error())
+            return QryptIO::CompressionError;
+        else
+            return QryptIO::WriteFailed;
+    }
+
+    /**
+     * @brief pipe the stream into sink on a worker thread, when pipelined
+     * @param pipe receives the PipeSink, delete it before sink
+     * @return the sink to write into
+     */
+    Qrypto::Sink *pipe(Qrypto::Sink *sink, QScopedPointer<Qrypto::Sink> &pipe) const
+    {
+        if (pipelined)
+            pipe.reset(new Qrypto::PipeSink(sink));
+
+        return pipe ? pipe.data() : sink;
+    }
+
+    /**
+     * @brief lengthHint of plain data to reserve in memory, 0 if it cannot fit in a QByteArray
+     */
+    int lengthHint() const
+    { return length > 0 && length <= std::numeric_limits<int>::max() ? int(length) : 0; }
+
+    /**
+     * @brief read source in chunks into sink, counting the length
+     * @return false with ReadPastEnd status if the source failed, or with error if the sink failed
+     */
+    bool read(QIODevice *source, Qrypto::Sink *sink)
+    {
+        Qrypto::SequreBytes chunk(ChunkSize, '\0');
+        qint64 size;
+        length = 0;
+
+        while ((size = source->read(chunk->data(), chunk.size())) > 0) {
+            error = sink->write(chunk->constData(), size);
+
+            if (error)
+                return false;
+
+            length += size;
+        }
+
+        if (size < 0)
+            status = QryptIO::ReadPastEnd;
+
+        return size == 0;
+    }
+
+    /**
+     * @brief The Data struct holds the text of a Data or HexData element until it is decoded
+     */
+    struct Data
+    {
+        QByteArray text;
+        QByteArray bytes;
+        bool hex;
+
+        Data(bool hex = false) :
+            hex(hex)
+        { }
+    };
+
+    /**
+     * @brief The DataDecoder struct decodes Data, leniently like QByteArray if the text is not strictly valid
+     */
+    struct DataDecoder
+    {
+        typedef void result_type;
+
+        void operator()(Data &data) const
+        {
+            data.bytes.resize(0); // keeps the reserved capacity for the next batch
+
+            if (data.hex && !Qrypto::Encoding::fromHex(data.bytes, data.text.constData(), data.text.size()))
+                data.bytes = QByteArray::fromHex(data.text);
+            else if (!data.hex && !Qrypto::Encoding::fromBase64(data.bytes, data.text.constData(), data.text.size()))
+                data.bytes = QByteArray::fromBase64(data.text);
+
+            data.text.resize(0);
+        }
+    };
+
+    /**
+     * @brief loadPayload decodes the first count Data elements in parallel and loads them in order
+     */
+    bool loadPayload(QVector<Data> &data, int count, Qrypto::Sink *payload)
+    {
+        QtConcurrent::blockingMap(data.begin(), data.begin() + count, DataDecoder());
+
+        for (int element = 0; element < count; ++element) {
+            if (!loadPayload(data.at(element).bytes, payload))
+                return false;
+        }
+
+        return true;
+    }
+
+    bool loadPayload(const QByteArray &data, Qrypto::Sink *payload)
+    {
+        if (!payload)
+            crypt += data;
+        else if (payload->write(data))
+            return false;
+
+        return true;
+    }
+
+    /**
+     * @brief loadTrailer reads the Trailer from the end of a random access device
+     */
+    bool loadTrailer()
+    {
+        const qint64 pos = device->pos();
+        const qint64 size = qMin<qint64>(device->size(), 4096);
+        QByteArray tail;
+
+        if (device->seek(device->size() - size))
+            tail = device->read(size);
+
+        if (!device->seek(pos) || tail.lastIndexOf("<Trailer>") < 0)
+            return false;
+
+        trailer = tail.mid(tail.lastIndexOf("<Trailer>"));
+        Xml xml(trailer);
+        resetTrailer();
+        return loadXml(xml, 0, false);
+    }
+
+    /**
+     * @brief loadXml loads a whole Cryptic V1 or V2 document from the device into crypt
+     */
+    bool loadXml()
+    {
+        Xml xml(device);
+        crypt.clear();
+        resetTrailer();
+        return loadXml(xml);
+    }
+
+    void setMembers(const QByteArray &members)
+    {
+        QList<int> sizes;
+
+        foreach (const QByteArray &size, members.simplified().split(' '))
+            sizes << size.toInt();
+
+        compress.setMembers(sizes);
+    }
+
+    QString members() const
+    {
+        QStringList sizes;
+
+        foreach (const int size, compress.members())
+            sizes << QString::number(size);
+
+        return sizes.join(' ');
+    }
+
+    /**
+     * @brief resetHeader to the defaults of optional Header elements
+     */
+    void resetHeader()
+    {
+        const Qrypto::KeyMaker defaults;
+        keyMaker.setFunction(Qrypto::KeyMaker::Pbkdf2);
+        keyMaker.setMemoryCost(defaults.memoryCost());
+        keyMaker.setParallelism(defaults.parallelism());
+        cipher.setSegmentSize(Qrypto::Cipher::DefaultSegmentSize);
+        cipher.setSegmentCount(0);
+    }
+
+    /**
+     * @brief resetTrailer to the defaults of optional Trailer elements
+     */
+    void resetTrailer()
+    {
+        compress.setMemberSize(0);
+        compress.setMembers(QList<int>());
+        compress.setDeflateLevel(6);
+        compress.setDictionary(Qrypto::Compress::NoDictionary);
+    }
+
+    /**
+     * @brief field finds an element of the Cryptic hierarchy in schema order
+     * @return index in Cryptic, -1 if unknown or out of order
+     */
+    static int field(const QByteArray &section, const QByteArray &name, int from)
+    {
+        for (int index = from; index < CrypticFields; ++index) {
+            if (section == Cryptic[index][0] && (name == Cryptic[index][1] || (index == 6 && name == "InitVector")))
+                return index; // V1 names the InitialVector InitVector
+        }
+
+        return -1;
+    }
+
+    /**
+     * @brief loadXml scans the sections of a Cryptic V1 or V2 document in a single pass
+     * @param xml positioned before the root element, or before a section if not root
+     * @param payload receives the Payload instead of crypt, if not null, after the Trailer was loaded
+     * @param root false to load a single section, such as the Trailer
+     * @return false if the document is not well-formed or the payload could not be loaded
+     */
+    bool loadXml(Xml &xml, Qrypto::Sink *payload = 0, bool root = true)
+    {
+        Q_ASSERT(crypticVersion > 0 || !root);
+        const int batch = qMax(QThread::idealThreadCount(), 1);
+        QVector<Data> data;
+        QByteArray section;
+        QByteArray text;
+        int count = 0;
+        int from = 0;
+        int index;
+
+        if (root) {
+            resetHeader();
+
+            if (xml.readNext() != Xml::StartElement || xml.empty)
+                return false;
+        }
+
+        for (;;) {
+            switch (xml.readNext()) {
+            case Xml::StartElement:
+                if (section.isEmpty() && !xml.empty) {
+                    section = xml.name;
+                    continue;
+                }
+
+                switch (index = field(section, xml.name, from)) {
+                case 12:
+                case 13:
+                    if (count == data.size()) {
+                        data.append(Data());
+                        data.last().text.reserve(ChunkSize); // so that resize(0) keeps the buffers
+                        data.last().bytes.reserve(ChunkSize);
+                    }
+
+                    data[count].hex = xml.name == "HexData";
+
+                    if (!xml.readText(data[count].text))
+                        return false;
+
+                    if (++count == batch && !loadPayload(data, count, payload))
+                        return false;
+
+                    count = count % batch;
+                    continue; // may occur many times
+                case 14:
+                    if (count && !loadPayload(data, count, payload))
+                        return false;
+
+                    count = 0;
+                    break;
+                case -1:
+                    if (!xml.skipElement())
+                        return false;
+
+                    continue;
+                }
+
+                text.resize(0);
+
+                if (!xml.readText(text))
+                    return false;
+
+                if (payload && index >= 14)
+                    index = -1; // loaded by loadTrailer, the pipelined stages may be reading it
+
+                switch (index) {
+                case  0: keyMaker.setAlgorithmName(QString::fromUtf8(text.trimmed())); break;
+                case  1: keyMaker.setSalt(QByteArray::fromHex(text)); break;
+                case  2: keyMaker.setIterationCount(text.trimmed().toUInt()); break;
+                case  3: keyMaker.setKeyLength(text.trimmed().toUInt()); break;
+                case  4: cipher.setAlgorithmName(QString::fromUtf8(text.trimmed())); break;
+                case  5: cipher.setOperationCode(QString::fromUtf8(text.trimmed())); break;
+                case  6: cipher.setInitialVector(QByteArray::fromHex(text)); break;
+                case  7: cipher.setSegmentSize(text.trimmed().toInt()); break;
+                case  8: cipher.setSegmentCount(text.trimmed().toUInt()); break;
+                case  9: keyMaker.setFunctionName(QString::fromUtf8(text.trimmed())); break;
+                case 10: keyMaker.setMemoryCost(text.trimmed().toUInt()); break;
+                case 11: keyMaker.setParallelism(text.trimmed().toUInt()); break;
+                case 14:
+                    length = text.trimmed().toLongLong();
+
+                    if (root && !payload)
+                        plain.reserve(lengthHint());
+
+                    break;
+                case 15: cipher.setAuthentication(QByteArray::fromHex(text)); break;
+                case 16: compress.setAlgorithmName(QString::fromUtf8(text.trimmed())); break;
+                case 17: compress.setMemberSize(text.trimmed().toInt()); break;
+                case 18:
+                    if (!compress.memberSize())
+                        return false; // MemberSize precedes the Members index
+
+                    setMembers(text);
+                    break;
+                case 19: compress.setDeflateLevel(text.trimmed().toInt()); break;
+                case 20: compress.setDictionary(text.trimmed().toInt()); break;
+                }
+
+                ++from;
+                break;
+            case Xml::EndElement:
+                if (root && !section.isEmpty()) {
+                    section.clear();
+                    break;
+                }
+
+                return !count || loadPayload(data, count, payload); // end of the root or the single section
+            default:
+                return false;
+            }
+        }
+    }
+
+    void loadHeaderV3(const QByteArray &header)
+    {
+        QBuffer buffer;
+        QByteArray content;
+        uchar tag;
+        this->header = header;
+        buffer.setData(header);
+        buffer.open(QIODevice::ReadOnly);
+        resetHeader();
+
+        for (int i = 0; Der::read(&buffer, tag, content); ) {
+            if (tag == (Der::Context | 0))
+                cipher.setSegmentSize(int(qMin<qint64>(Der::toInteger(content), 1 << 30)));
+            else if (tag == (Der::Context | 1))
+                cipher.setSegmentCount(quint32(Der::toInteger(content)));
+            else if (tag == (Der::Context | 2))
+                keyMaker.setFunctionName(QString::fromUtf8(content));
+            else if (tag == (Der::Context | 3))
+                keyMaker.setMemoryCost(uint(Der::toInteger(content)));
+            else if (tag == (Der::Context | 4))
+                keyMaker.setParallelism(uint(Der::toInteger(content)));
+
+            if (tag & 0xC0)
+                continue; // tagged optional elements
+
+            switch (i++) {
+            case 0: keyMaker.setAlgorithmName(QString::fromUtf8(content)); break;
+            case 1: keyMaker.setSalt(content); break;
+            case 2: keyMaker.setIterationCount(Der::toInteger(content)); break;
+            case 3: keyMaker.setKeyLength(Der::toInteger(content)); break;
+            case 4: cipher.setAlgorithmName(QString::fromUtf8(content)); break;
+            case 5: cipher.setOperationCode(QString::fromUtf8(content)); break;
+            case 6: cipher.setInitialVector(content); break;
+            default: break;
+            }
+        }
+    }
+
+    /**
+     * @brief loadTrailerV3
+     * @return false if the members index comes without a memberSize
+     */
+    bool loadTrailerV3(const QByteArray &trailer, bool reserve)
+    {
+        QBuffer buffer;
+        QByteArray content;
+        uchar tag;
+        this->trailer = trailer;
+        buffer.setData(trailer);
+        buffer.open(QIODevice::ReadOnly);
+        resetTrailer();
+
+        for (int i = 0; Der::read(&buffer, tag, content); ) {
+            if (tag == (Der::Context | 0)) {
+                compress.setMemberSize(int(qMin<qint64>(Der::toInteger(content), 1 << 30)));
+            } else if (tag == (Der::Context | Der::Constructed | 1)) {
+                QBuffer sizes(&content);
+                QList<int> members;
+                QByteArray size;
+                uchar integer;
+                sizes.open(QIODevice::ReadOnly);
+
+                while (Der::read(&sizes, integer, size) && integer == Der::Integer)
+                    members << int(Der::toInteger(size));
+
+                if (!compress.memberSize())
+                    return false; // memberSize precedes the members index
+
+                compress.setMembers(members);
+            } else if (tag == (Der::Context | 2)) {
+                compress.setDeflateLevel(int(Der::toInteger(content)));
+            } else if (tag == (Der::Context | 3)) {
+                compress.setDictionary(int(Der::toInteger(content)));
+            }
+
+            if (tag & 0xC0)
+                continue; // tagged optional elements
+
+            switch (i++) {
+            case 0:
+                length = Der::toInteger(content);
+
+                if (reserve)
+                    plain.reserve(lengthHint());
+
+                break;
+            case 1: cipher.setAuthentication(content); break;
+            case 2: compress.setAlgorithmName(QString::fromUtf8(content)); break;
+            default: break;
+            }
+        }
+
+        return true;
+    }
+
+    /**
+     * @brief readHeader loads the Header from the first bytes of the device, without consuming them
+     */
+    bool readHeader()
+    {
+        const QByteArray peek(device->peek(HeaderSize));
+        resetHeader();
+
+        if (crypticVersion == 3) {
+            QBuffer buffer;
+            QByteArray content;
+            qint64 size;
+            uchar tag;
+            buffer.setData(peek);
+            buffer.open(QIODevice::ReadOnly);
+
+            if (!Der::readHeader(&buffer, tag, size) || tag != Der::Sequence ||
+                    !Der::read(&buffer, tag, content) || tag != Der::Integer ||
+                    !Der::read(&buffer, tag, content) || tag != Der::Sequence)
+                return false;
+
+            loadHeaderV3(content);
+            return true;
+        }
+
+        const int from = peek.indexOf("<Header");
+        const int to = peek.indexOf("</Header>", from);
+
+        if (from < 0 || to < 0)
+            return false;
+
+        header = peek.mid(from, to + 9 - from);
+        Xml xml(header);
+        return loadXml(xml, 0, false);
+    }
+
+    /**
+     * @brief readTrailer loads the Trailer of a random access device, skipping the Payload
+     */
+    bool readTrailer()
+    {
+        if (device->isSequential())
+            return false;
+        else if (crypticVersion != 3)
+            return loadTrailer();
+
+        const qint64 pos = device->pos();
+        const bool loaded = loadV3(0, true);
+        return device->seek(pos) && loaded;
+    }
+
+    /**
+     * @brief loadMetadata loads raw Header and Trailer sections as saved by the QryptCache
+     */
+    bool loadMetadata(int version, const QByteArray &header, const QByteArray &trailer)
+    {
+        crypticVersion = version;
+        resetHeader();
+
+        if (version == 3) {
+            loadHeaderV3(header);
+            return loadTrailerV3(trailer, false);
+        }
+
+        Xml headerXml(header);
+        Xml trailerXml(trailer);
+        resetTrailer();
+        return version > 0 && loadXml(headerXml, 0, false) && loadXml(trailerXml, 0, false);
+    }
+
+    /**
+     * @brief loadV3 reads the binary document from the current device position
+     * @param payload receives the Payload instead of crypt, if not null, after the Trailer was loaded
+     * @param skipPayload seeks over the Payload to read the Trailer only
+     * @param mapped device memory, payload will be written from it without reading
+     * @return
+     */
+    bool loadV3(Qrypto::Sink *payload = 0, bool skipPayload = false, const uchar *mapped = 0)
+    {
+        Q_ASSERT(crypticVersion > 0);
+        QByteArray content;
+        qint64 size;
+        uchar tag;
+
+        if (!payload && !skipPayload)
+            crypt.clear();
+
+        if (!Der::readHeader(device, tag, size) || tag != Der::Sequence ||
+                !Der::read(device, tag, content) || tag != Der::Integer ||
+                !Der::read(device, tag, content) || tag != Der::Sequence)
+            return false;
+
+        loadHeaderV3(content);
+
+        if (!Der::readHeader(device, tag, size) || tag != Der::Sequence)
+            return false;
+
+        const qint64 end = size == Der::Indefinite ? -1 : device->pos() + size;
+
+        while (end < 0 || device->pos() < end) {
+            if (!Der::readHeader(device, tag, size))
+                return false;
+            else if (tag == Der::EndOfContents && end < 0)
+                break;
+            else if (tag != Der::OctetString || size < 0 || size > device->bytesAvailable())
+                return false;
+
+            if (skipPayload) {
+                if (!device->seek(device->pos() + size))
+                    return false;
+            } else if (payload && mapped) {
+                if (payload->write(reinterpret_cast<const char*>(mapped) + device->pos(), size) ||
+                        !device->seek(device->pos() + size))
+                    return false;
+            } else if (payload) {
+                for (QByteArray chunk; size > 0; size -= chunk.size()) {
+                    chunk = device->read(qMin<qint64>(size, ChunkSize));
+
+                    if (chunk.isEmpty() || payload->write(chunk))
+                        return false;
+                }
+            } else {
+                const int from = crypt.size();
+                crypt.resize(from + size);
+
+                if (device->read(crypt.data() + from, size) != size)
+                    return false;
+            }
+        }
+
+        if (!Der::read(device, tag, content) || tag != Der::Sequence)
+            return false;
+
+        return payload || loadTrailerV3(content, !skipPayload); // loaded before, the pipelined stages may be reading it
+    }
+
+    bool save()
+    {
+        if (crypticVersion == 3)
+            return saveV3();
+
+        QXmlStreamWriter xml(device);
+
+        writeHeader(xml);
+        xml.writeStartElement("Payload");
+        writePayload(xml, crypt.constData(), crypt.size());
+        xml.writeEndElement();
+        writeTrailer(xml);
+        return !xml.hasError();
+    }
+
+    /**
+     * @brief saveV3 writes the binary document with definite lengths
+     */
+    bool saveV3()
     {
-        return device && (device->isWritable() || device->open(QIODevice::WriteOnly));
-    }
+        const QByteArray version(Der::integer(crypticVersion));
+        const QByteArray header(headerV3());
+        const QByteArray trailer(trailerV3());
+        qint64 size = 0;
 
-    bool loadV1()
-    {
-        Q_ASSERT(crypticVersion > 0);
-        QXmlStreamReader xml(device);
-        int from = 0;
-        crypt.clear();
+        for (Qrypto::Pointerator<const char> it(crypt.constData(), crypt.size()), chunk; !it.atEnd(); ) {
+            chunk = it.read(DataSize);
+            size += Der::header(Der::OctetString, chunk.size()).size() + chunk.size();
+        }
+
+        QByteArray der(Der::header(Der::Sequence, version.size() + header.size() +
+                                   Der::header(Der::Sequence, size).size() + size + trailer.size()));
+        der += version;
+        der += header;
+        der += Der::header(Der::Sequence, size);
 
-        if (!xml.readNextStartElement())
+        if (device->write(der) != der.size())
             return false;
 
-        for (QString path; !xml.atEnd(); ) {
-            switch (xml.readNext()) {
-            case QXmlStreamReader::StartElement:
-                path += '/';
-                path += xml.name();
-
-                switch (CrypticV1.indexOf(path, from)) {
-                case 0: keyMaker.setAlgorithmName(xml.readElementText()); break;
-                case 1: keyMaker.setSalt(xml.readElementText()); break;
-                case 2: keyMaker.setIterationCount(xml.readElementText().toUInt()); break;
-                case 3: keyMaker.setKeyLength(xml.readElementText().toUInt()); break;
-                case 4: cipher.setAlgorithmName(xml.readElementText()); break;
-                case 5: cipher.setOperationCode(xml.readElementText()); break;
-                case 6: cipher.setInitialVector(xml.readElementText()); break;
-                case 7:
-                    crypt += QByteArray::fromBase64(xml.readElementText().toLatin1());
-                    --from; // may occur many times
-                    break;
-                case 8:
-                    crypt += QByteArray::fromHex(xml.readElementText().toLatin1());
-                    --from; // may occur many times
-                    break;
-                case 9: plain.reserve(xml.readElementText().toUInt()); break;
-                default:
-                    continue;
-                }
+        for (Qrypto::Pointerator<const char> it(crypt.constData(), crypt.size()), chunk; !it.atEnd(); ) {
+            chunk = it.read(DataSize);
+            der = Der::header(Der::OctetString, chunk.size());
 
-                ++from;
-                /* FALLTHRU */
-            case QXmlStreamReader::EndElement:
-                path = path.section('/', 0, -2);
-                break;
-            default:
-                continue;
-            }
+            if (device->write(der) != der.size() || device->write(chunk.data(), chunk.size()) != chunk.size())
+                return false;
         }
 
-        return !xml.hasError();
+        return device->write(trailer) == trailer.size();
     }
 
-    bool loadV2()
+    QByteArray headerV3() const
     {
-        Q_ASSERT(crypticVersion > 0);
-        QXmlStreamReader xml(device);
-        int from = 0;
-        crypt.clear();
+        QByteArray extensions;
 
-        if (!xml.readNextStartElement())
-            return false;
+        if (cipher.operation() == Qrypto::Cipher::STREAM) {
+            extensions = Der::integer(cipher.segmentSize(), Der::Context | 0);
 
-        for (QString path; !xml.atEnd(); ) {
-            switch (xml.readNext()) {
-            case QXmlStreamReader::StartElement:
-                path += '/';
-                path += xml.name();
-
-                switch (CrypticV2.indexOf(path, from)) {
-                case  0: keyMaker.setAlgorithmName(xml.readElementText()); break;
-                case  1: keyMaker.setSalt(xml.readElementText()); break;
-                case  2: keyMaker.setIterationCount(xml.readElementText().toUInt()); break;
-                case  3: keyMaker.setKeyLength(xml.readElementText().toUInt()); break;
-                case  4: cipher.setAlgorithmName(xml.readElementText()); break;
-                case  5: cipher.setOperationCode(xml.readElementText()); break;
-                case  6: cipher.setInitialVector(xml.readElementText()); break;
-                case  7:
-                    crypt += QByteArray::fromBase64(xml.readElementText().toLatin1());
-                    --from; // may occur many times
-                    break;
-                case  8:
-                    crypt += QByteArray::fromHex(xml.readElementText().toLatin1());
-                    --from; // may occur many times
-                    break;
-                case  9: plain.reserve(xml.readElementText().toUInt()); break;
-                case 10: cipher.setAuthentication(xml.readElementText()); break;
-                case 11: compress.setAlgorithmName(xml.readElementText()); break;
-                default:
-                    continue;
-                }
+            if (cipher.segmentCount())
+                extensions += Der::integer(cipher.segmentCount(), Der::Context | 1);
+        }
 
-                ++from;
-                /* FALLTHRU */
-            case QXmlStreamReader::EndElement:
-                path = path.section('/', 0, -2);
-                break;
-            default:
-                continue;
-            }
+        if (keyMaker.function() != Qrypto::KeyMaker::Pbkdf2) {
+            extensions += Der::encode(Der::Context | 2, keyMaker.functionName().toUtf8()) +
+                          Der::integer(keyMaker.memoryCost(), Der::Context | 3) +
+                          Der::integer(keyMaker.parallelism(), Der::Context | 4);
         }
 
-        return !xml.hasError();
+        return Der::encode(Der::Sequence,
+                           Der::encode(Der::Utf8String, keyMaker.algorithmName().toUtf8()) +
+                           Der::encode(Der::OctetString, keyMaker.salt()) +
+                           Der::integer(keyMaker.iterationCount()) +
+                           Der::integer(keyMaker.keyLength()) +
+                           Der::encode(Der::Utf8String, cipher.algorithmName().toUtf8()) +
+                           Der::encode(Der::Utf8String, cipher.operationCode().toUtf8()) +
+                           Der::encode(Der::OctetString, cipher.initialVector()) +
+                           extensions);
     }
 
-    bool save()
+    /**
+     * @brief hasDictionary the preset dictionary is used by the compression algorithm
+     */
+    bool hasDictionary() const
     {
-        QXmlStreamWriter xml(device);
+        return compress.algorithm() == Qrypto::Compress::Zstd &&
+                compress.dictionary() != Qrypto::Compress::NoDictionary;
+    }
+
+    QByteArray trailerV3() const
+    {
+        QByteArray members;
+
+        if (!compress.members().isEmpty()) {
+            foreach (const int size, compress.members())
+                members += Der::integer(size);
+
+            members = Der::integer(compress.memberSize(), Der::Context | 0) +
+                      Der::encode(Der::Context | Der::Constructed | 1, members);
+        }
+
+        QByteArray compression;
+
+        if (compress.algorithm() != Qrypto::Compress::Identity)
+            compression = Der::integer(compress.deflateLevel(), Der::Context | 2);
 
+        if (hasDictionary())
+            compression += Der::integer(compress.dictionary(), Der::Context | 3);
+
+        return Der::encode(Der::Sequence,
+                           Der::integer(length) +
+                           Der::encode(Der::OctetString, cipher.authentication()) +
+                           Der::encode(Der::Utf8String, compress.algorithmName().toUtf8()) +
+                           members +
+                           compression);
+    }
+
+    void writeHeader(QXmlStreamWriter &xml)
+    {
         xml.setAutoFormatting(true);
         xml.setAutoFormattingIndent(-1);
 
@@ -163,48 +1253,308 @@ struct QryptIO::Private
         xml.writeTextElement("Cipher", cipher.algorithmName());
         xml.writeTextElement("Method", cipher.operationCode());
         xml.writeTextElement("InitialVector", QString::fromLatin1(cipher.initialVector().toHex()));
-        xml.writeEndElement();
 
-        xml.writeStartElement("Payload");
+        if (cipher.operation() == Qrypto::Cipher::STREAM) {
+            xml.writeTextElement("SegmentSize", QString::number(cipher.segmentSize()));
 
-        for (Qrypto::Pointerator<const char> it(crypt.constData(), crypt.size()), chunk; !it.atEnd(); ) {
-            QString text;
-            chunk = it.read(524288);
-            text.reserve(chunk.size() * 8 / 6 + chunk.size() / 180);
-
-            for (Qrypto::Pointerator<const char> end = chunk.end(), line; chunk != end; ) {
-                line = chunk.read(180);
-                text += QChar('\n');
-                text += QString::fromLatin1(QByteArray(line.data(), line.size()).toBase64());
-            }
+            if (cipher.segmentCount())
+                xml.writeTextElement("SegmentCount", QString::number(cipher.segmentCount()));
+        }
 
-            xml.writeTextElement("Data", text);
+        if (keyMaker.function() != Qrypto::KeyMaker::Pbkdf2) {
+            xml.writeTextElement("Derivation", keyMaker.functionName());
+            xml.writeTextElement("MemoryCost", QString::number(keyMaker.memoryCost()));
+            xml.writeTextElement("Parallelism", QString::number(keyMaker.parallelism()));
         }
 
         xml.writeEndElement();
+    }
+
+    /**
+     * @brief The DataEncoder struct encodes a chunk of the payload into the text of its Data element
+     */
+    struct DataEncoder
+    {
+        typedef void result_type;
+        const char *batch;
+        QString *texts;
+
+        DataEncoder(const char *batch, QString *texts) :
+            batch(batch),
+            texts(texts)
+        { }
+
+        void operator()(Qrypto::Pointerator<const char> &chunk) const
+        {
+            texts[(chunk.data() - batch) / DataSize] =
+                    QString::fromLatin1(Qrypto::Encoding::toBase64(chunk.data(), int(chunk.size()), 180));
+        }
+    };
+
+    /**
+     * @brief writePayload encodes as many Data elements as threads at a time
+     */
+    void writePayload(QXmlStreamWriter &xml, const char *data, int size)
+    {
+        QVector<QString> texts(qMax(QThread::idealThreadCount(), 1));
+
+        for (Qrypto::Pointerator<const char> it(data, size), batch; !it.atEnd(); ) {
+            batch = it.read(size_t(texts.size()) * DataSize);
+            batch.parallelForEachChunk(DataEncoder(batch.data(), texts.data()), DataSize);
 
+            for (size_t text = 0; text * DataSize < batch.size(); ++text)
+                xml.writeTextElement("Data", texts.at(int(text)));
+        }
+    }
+
+    void writeTrailer(QXmlStreamWriter &xml)
+    {
         xml.writeStartElement("Trailer");
-        xml.writeTextElement("Length", QString::number(plain.size()));
+        xml.writeTextElement("Length", QString::number(length));
         xml.writeTextElement("Authentication", QString::fromLatin1(cipher.authentication().toHex()));
         xml.writeTextElement("Compression", compress.algorithmName());
+
+        if (!compress.members().isEmpty()) {
+            xml.writeTextElement("MemberSize", QString::number(compress.memberSize()));
+            xml.writeTextElement("Members", members());
+        }
+
+        if (compress.algorithm() != Qrypto::Compress::Identity)
+            xml.writeTextElement("CompressionLevel", QString::number(compress.deflateLevel()));
+
+        if (hasDictionary())
+            xml.writeTextElement("Dictionary", QString::number(compress.dictionary()));
+
         xml.writeEndElement();
 
         xml.writeEndDocument();
-        return !xml.hasError();
     }
 };
 
-const QStringList QryptIO::Private::CrypticV1 =
-        QStringList() << "/Header/Digest" << "/Header/Salt" << "/Header/IterationCount" <<
-                         "/Header/KeyLength" << "/Header/Cipher" << "/Header/Method" <<
-                         "/Header/InitVector" << "/Payload/Data" << "/Payload/HexData" <<
-                         "/Trailer/Length";
+const char *const QryptIO::Private::Cryptic[CrypticFields][2] = {
+    { "Header", "Digest" }, { "Header", "Salt" }, { "Header", "IterationCount" },
+    { "Header", "KeyLength" }, { "Header", "Cipher" }, { "Header", "Method" },
+    { "Header", "InitialVector" }, { "Header", "SegmentSize" }, { "Header", "SegmentCount" },
+    { "Header", "Derivation" }, { "Header", "MemoryCost" }, { "Header", "Parallelism" },
+    { "Payload", "Data" }, { "Payload", "HexData" },
+    { "Trailer", "Length" }, { "Trailer", "Authentication" }, { "Trailer", "Compression" },
+    { "Trailer", "MemberSize" }, { "Trailer", "Members" }, { "Trailer", "CompressionLevel" },
+    { "Trailer", "Dictionary" }
+};
+
+/**
+ * @brief The Decryption struct opens the decryption stages on the first Payload data
+ */
+struct QryptIO::Private::Decryption : Qrypto::Sink
+{
+    Private *d;
+    Qrypto::Sink *output;
+    const Qrypto::SequreBytes &password;
+    QScopedPointer<Qrypto::Sink> inflater;
+    QScopedPointer<Qrypto::Sink> decryptor;
+    QScopedPointer<Qrypto::Sink> outputPipe; // pipes are deleted before the stages they feed
+    QScopedPointer<Qrypto::Sink> inflaterPipe;
+    QScopedPointer<Qrypto::Sink> decryptorPipe;
+
+    Decryption(Private *d, Qrypto::Sink *output, const Qrypto::SequreBytes &password) :
+        d(d),
+        output(output),
+        password(password)
+    { }
+
+    bool open()
+    {
+        d->error = d->keyMaker.deriveKey(*password, d->cipher.validateKeyLength(d->keyMaker.keyLength()));
+
+        if (d->error) {
+            d->status = KeyDerivationError;
+            return false;
+        }
+
+        inflater.reset(d->compress.inflater(d->pipe(output, outputPipe), false, &d->error));
+
+        if (!inflater) {
+            d->status = CompressionError;
+            return false;
+        }
+
+        decryptor.reset(d->cipher.decryptor(d->pipe(inflater.data(), inflaterPipe), d->keyMaker, &d->error));
+
+        if (!decryptor) {
+            d->status = CryptographicError;
+            return false;
+        }
+
+        d->pipe(decryptor.data(), decryptorPipe);
+        return true;
+    }
+
+    Qrypto::Sink *input() const
+    { return decryptorPipe ? decryptorPipe.data() : decryptor.data(); }
+
+    /**
+     * @brief fail blames the decryption for a failure before the cipher stage has closed successfully,
+     * unless the output failed or memory ran out
+     * @note plain data is inflated before the HMAC or tag is verified, so a wrong password
+     * typically fails in the inflater first
+     */
+    Qrypto::Error fail(Qrypto::Error error)
+    {
+        decryptorPipe.reset(); // joins the stages before reading their errors
+        inflaterPipe.reset();
+        outputPipe.reset();
+
+        if (output->error()) {
+            d->status = QryptIO::WriteFailed;
+            d->error = output->error();
+        } else if (decryptor->error() || error != Qrypto::OutOfMemory) {
+            d->status = QryptIO::CryptographicError;
+            d->error = decryptor->error() ? decryptor->error() : Qrypto::IntegrityError;
+        } else {
+            d->status = d->failure(decryptor.data(), inflater.data());
+            d->error = error;
+        }
+
+        return m_error = d->error;
+    }
+
+    Qrypto::Error write(const char *data, qint64 size)
+    {
+        if (m_error || (!decryptor && !open()))
+            return d->error;
+
+        const Qrypto::Error error = input()->write(data, size);
+        return error ? fail(error) : Qrypto::NoError;
+    }
+
+    Qrypto::Error close()
+    {
+        if (m_error || (!decryptor && !open()))
+            return d->error;
+
+        const Qrypto::Error error = input()->close();
+        return error ? fail(error) : Qrypto::NoError;
+    }
+};
+
+/**
+ * @brief The Encryption struct writes the cryptic document around the Payload stream
+ */
+struct QryptIO::Private::Encryption : Qrypto::Sink
+{
+    Private *d;
+    QXmlStreamWriter xml;
+    QByteArray buffer;
+
+    Encryption(Private *d) :
+        d(d),
+        xml(d->device)
+    { }
+
+    void open()
+    {
+        if (d->crypticVersion == 3) {
+            put(Der::header(Der::Sequence, Der::Indefinite) + Der::integer(d->crypticVersion) +
+                d->headerV3() + Der::header(Der::Sequence, Der::Indefinite));
+        } else {
+            d->writeHeader(xml);
+            xml.writeStartElement("Payload");
+        }
+
+        buffer.reserve(DataSize);
+    }
+
+    void put(const QByteArray &der)
+    {
+        if (!m_error && d->device->write(der) != der.size())
+            m_error = Qrypto::UnknownError;
+    }
+
+    void flush()
+    {
+        if (buffer.isEmpty()) {
+            return;
+        } else if (d->crypticVersion == 3) {
+            put(Der::header(Der::OctetString, buffer.size()));
+            put(buffer);
+        } else {
+            d->writePayload(xml, buffer.constData(), buffer.size());
+        }
+
+        buffer.resize(0);
+    }
+
+    Qrypto::Error status()
+    {
+        if (xml.hasError())
+            m_error = Qrypto::UnknownError;
+
+        return m_error;
+    }
+
+    Qrypto::Error write(const char *data, qint64 size)
+    {
+        for (Qrypto::Pointerator<const char> it(data, size), chunk; !it.atEnd(); ) {
+            chunk = it.read(DataSize - buffer.size());
+            buffer.append(chunk.data(), chunk.size());
+
+            if (buffer.size() == DataSize)
+                flush();
+        }
+
+        return status();
+    }
+
+    Qrypto::Error close()
+    {
+        flush();
+        buffer.clear();
+
+        if (d->crypticVersion == 3) {
+            put(Der::endOfContents() + d->trailerV3() + Der::endOfContents());
+        } else {
+            xml.writeEndElement();
+            d->writeTrailer(xml);
+        }
+
+        return status();
+    }
+};
+
+/**
+ * @brief QryptIO::Private::decryptFile streams a cryptic file straight into plain output
+ * @note avoids whole crypt and compressed plain copies, V3 Payload is read from a memory map
+ */
+bool QryptIO::Private::decryptFile(QFile *file, Qrypto::SequreBytes &output, const Qrypto::SequreBytes &password)
+{
+    const qint64 pos = file->pos();
+    uchar *mapped = crypticVersion == 3 ? file->map(0, file->size()) : 0;
+    Qrypto::BytesSink sink(output);
+    Decryption payload(this, &sink, password);
+    bool loaded;
+
+    if (crypticVersion == 3) {
+        loaded = loadV3(0, true) && file->seek(pos);
+        output.reserve(lengthHint());
+        loaded = loaded && loadV3(&payload, false, mapped);
+    } else {
+        Xml xml(file);
+        loaded = loadTrailer();
+        output.reserve(lengthHint());
+        loaded = loaded && loadXml(xml, &payload);
+    }
+
+    if (loaded)
+        payload.close();
+    else if (status == QryptIO::Ok)
+        status = QryptIO::ReadCorruptData;
+
+    if (mapped)
+        file->unmap(mapped);
 
-const QStringList QryptIO::Private::CrypticV2 =
-        QStringList() << "/Header/Digest" << "/Header/Salt" << "/Header/IterationCount" <<
-                         "/Header/KeyLength" << "/Header/Cipher" << "/Header/Method" <<
-                         "/Header/InitialVector" << "/Payload/Data" << "/Payload/HexData" <<
-                         "/Trailer/Length" << "/Trailer/Authentication" << "/Trailer/Compression";
+    file->seek(pos); // allows decrypting again with another password
+    return status == QryptIO::Ok;
+}
 
 QryptIO::QryptIO(QIODevice *device) :
     d(new Private(device))
@@ -219,13 +1569,15 @@ int QryptIO::crypticVersion()
 {
     if (d->crypticVersion == -1 && d->isReadable()) {
         QByteArray peek(d->device->peek(512));
-        QXmlStreamReader xml(peek);
+        Xml xml(peek.startsWith("\xEF\xBB\xBF") ? peek.mid(3) : peek);
 
-        if (xml.readNextStartElement() && xml.name() == "Cryptic") {
-            foreach (const QXmlStreamAttribute &attr, xml.attributes()) {
-                if (attr.name() == "schemaVersion")
-                    d->crypticVersion = attr.value().toInt();
-            }
+        if (Der::version(peek) > 0) {
+            d->crypticVersion = Der::version(peek);
+
+            if (d->crypticVersion != 3)
+                d->crypticVersion = -2;
+        } else if (xml.readNext() == Xml::StartElement && !xml.characters && xml.name == "Cryptic") {
+            d->crypticVersion = xml.attribute("schemaVersion").trimmed().toInt();
 
             if (d->crypticVersion < 1 || d->crypticVersion > 2)
                 d->crypticVersion = -2;
@@ -258,6 +1610,17 @@ QryptIO::Status QryptIO::decrypt(QByteArray &data, const QString &password)
 
         switch (crypticVersion()) {
         case 0: // non-cryptic
+            if (QFile *file = d->mappable()) {
+                const qint64 size = file->size() - file->pos();
+                uchar *mapped = file->map(file->pos(), size);
+
+                if (mapped) {
+                    QByteArray(reinterpret_cast<const char*>(mapped), size).swap(d->crypt);
+                    file->unmap(mapped);
+                    file->seek(file->size());
+                }
+            }
+
             if (!d->device->atEnd())
                 d->device->readAll().swap(d->crypt);
 
@@ -268,7 +1631,7 @@ QryptIO::Status QryptIO::decrypt(QByteArray &data, const QString &password)
 
             break;
         case 1:
-            if (!d->crypt.isEmpty() || d->loadV1()) {
+            if (!d->crypt.isEmpty() || d->loadXml()) {
                 d->error = d->keyMaker.deriveKey(*sequre, d->cipher.validateKeyLength(d->keyMaker.keyLength()));
 
                 if (d->error) {
@@ -292,7 +1655,13 @@ QryptIO::Status QryptIO::decrypt(QByteArray &data, const QString &password)
 
             break;
         case 2:
-            if (!d->crypt.isEmpty() || d->loadV2()) {
+        case 3:
+            if (d->crypt.isEmpty() && d->mappable()) {
+                Qrypto::SequreBytes output;
+
+                if (d->decryptFile(d->mappable(), output, sequre))
+                    output->swap(data);
+            } else if (!d->crypt.isEmpty() || (d->crypticVersion == 3 ? d->loadV3() : d->loadXml())) {
                 d->error = d->keyMaker.deriveKey(*sequre, d->cipher.validateKeyLength(d->keyMaker.keyLength()));
 
                 if (d->error) {
@@ -303,8 +1672,10 @@ QryptIO::Status QryptIO::decrypt(QByteArray &data, const QString &password)
 
                     if (d->error) {
                         d->status = CryptographicError;
+                    } else if (d->compress.algorithm() == Qrypto::Compress::Identity) {
+                        d->plain->swap(data);
                     } else {
-                        sequre.reserve(d->plain.capacity());
+                        sequre.reserve(d->lengthHint()); // Trailer/Length hint
                         sequre.resize(0);
                         d->error = d->compress.inflate(sequre, *d->plain);
 
@@ -329,11 +1700,116 @@ QryptIO::Status QryptIO::decrypt(QByteArray &data, const QString &password)
     return d->status;
 }
 
+QryptIO::Status QryptIO::decrypt(QIODevice *sink, const QString &password)
+{
+    d->error = Qrypto::NoError;
+    d->status = Ok;
+
+    if (!sink || !(sink->isWritable() || sink->open(QIODevice::WriteOnly))) {
+        d->status = WriteFailed;
+    } else if (d->isReadable()) {
+        Qrypto::DeviceSink output(sink);
+        Qrypto::SequreBytes sequre;
+
+        switch (crypticVersion()) {
+        case 0: // non-cryptic
+            if (!d->read(d->device, &output) && d->error)
+                d->status = WriteFailed;
+
+            break;
+        case 2:
+            if (!d->device->isSequential() && d->loadTrailer()) {
+                const Qrypto::SequreBytes pwd(password.toUtf8());
+                Private::Decryption payload(d, &output, pwd);
+                Xml xml(d->device);
+
+                if (!d->loadXml(xml, &payload)) {
+                    if (d->status == Ok)
+                        d->status = ReadCorruptData;
+                } else {
+                    payload.close();
+                }
+
+                break;
+            }
+            /* FALLTHRU */
+        case 3:
+            if (d->crypticVersion == 3 && !d->device->isSequential()) {
+                const qint64 pos = d->device->pos();
+                const Qrypto::SequreBytes pwd(password.toUtf8());
+                Private::Decryption payload(d, &output, pwd);
+
+                if (!d->loadV3(0, true) || !d->device->seek(pos) || !d->loadV3(&payload)) {
+                    if (d->status == Ok)
+                        d->status = ReadCorruptData;
+                } else {
+                    payload.close();
+                }
+
+                break;
+            }
+            /* FALLTHRU */
+        default: // the whole Payload is needed before decryption
+            if (decrypt(*sequre, password) == Ok && output.write(*sequre))
+                d->status = WriteFailed;
+        }
+    } else {
+        d->status = ReadPastEnd;
+    }
+
+    return d->status;
+}
+
 QIODevice *QryptIO::device() const
 {
     return d->device;
 }
 
+QryptIO::Status QryptIO::readHeader()
+{
+    d->error = Qrypto::NoError;
+    d->status = Ok;
+
+    if (!d->isReadable())
+        d->status = ReadPastEnd;
+    else if (crypticVersion() <= 0 || !d->readHeader())
+        d->status = ReadCorruptData;
+
+    return d->status;
+}
+
+QryptIO::Status QryptIO::readTrailer()
+{
+    d->error = Qrypto::NoError;
+    d->status = Ok;
+
+    if (!d->isReadable() || d->device->isSequential())
+        d->status = ReadPastEnd;
+    else if (crypticVersion() <= 0 || !d->readTrailer())
+        d->status = ReadCorruptData;
+
+    return d->status;
+}
+
+qint64 QryptIO::length() const
+{
+    return d->length;
+}
+
+void QryptIO::metadata(int &version, QByteArray &header, QByteArray &trailer) const
+{
+    version = d->crypticVersion;
+    header = d->header;
+    trailer = d->trailer;
+}
+
+QryptIO::Status QryptIO::setMetadata(int version, const QByteArray &header, const QByteArray &trailer)
+{
+    d->error = Qrypto::NoError;
+    d->status = d->loadMetadata(version, header, trailer) ? Ok : ReadCorruptData;
+    return d->status;
+}
+
 QryptIO::Status QryptIO::encrypt(const QByteArray &data, const QString &password)
 {
     d->error = Qrypto::NoError;
@@ -350,18 +1826,22 @@ QryptIO::Status QryptIO::encrypt(const QByteArray &data, const QString &password
             if (d->error) {
                 d->status = KeyDerivationError;
             } else {
-                d->error = d->compress.deflate(d->plain, data);
+                d->compress.adapt(data.constData(), data.size());
+                const bool identity = d->compress.algorithm() == Qrypto::Compress::Identity;
+                d->compress.setMembers(QList<int>());
+                d->error = identity ? Qrypto::NoError : d->compress.deflate(d->plain, data, d->compress.deflateLevel());
 
                 if (d->error) {
                     d->status = CompressionError;
                 } else {
-                    d->error = d->cipher.encrypt(d->crypt, d->plain, d->keyMaker);
+                    d->error = identity ? d->cipher.encrypt(d->crypt, data.constData(), data.size(), d->keyMaker) :
+                                          d->cipher.encrypt(d->crypt, d->plain, d->keyMaker);
 
                     if (d->error) {
                         d->status = CryptographicError;
                     } else {
-                        d->crypticVersion = 2;
-                        d->plain.resize(data.size()); // plain length will be saved
+                        d->crypticVersion = d->crypticVersion == 3 ? 3 : 2;
+                        d->length = data.size();
 
                         if (d->save())
                             d->status = Ok;
@@ -374,11 +1854,89 @@ QryptIO::Status QryptIO::encrypt(const QByteArray &data, const QString &password
     return d->status;
 }
 
+QryptIO::Status QryptIO::encrypt(QIODevice *source, const QString &password)
+{
+    d->error = Qrypto::NoError;
+    d->status = WriteFailed;
+
+    if (!source || !(source->isReadable() || source->open(QIODevice::ReadOnly))) {
+        d->status = ReadPastEnd;
+    } else if (d->isWritable()) {
+        if (password.isEmpty()) {
+            Qrypto::DeviceSink output(d->device);
+
+            if (d->read(source, &output))
+                d->status = Ok;
+        } else {
+            const Qrypto::SequreBytes pwd(password.toUtf8());
+            d->error = d->keyMaker.deriveKey(*pwd, d->cipher.validateKeyLength(d->keyMaker.keyLength()));
+
+            if (d->error) {
+                d->status = KeyDerivationError;
+            } else {
+                Private::Encryption payload(d);
+                QScopedPointer<Qrypto::Sink> payloadPipe; // pipes are deleted before the stages they feed
+                QScopedPointer<Qrypto::Sink> encryptor(d->cipher.encryptor(d->pipe(&payload, payloadPipe),
+                                                                           d->keyMaker, &d->error));
+                QScopedPointer<Qrypto::Sink> encryptorPipe;
+                QScopedPointer<Qrypto::Sink> deflater;
+                QScopedPointer<Qrypto::Sink> deflaterPipe;
+
+                if (d->compress.deflateTime()) {
+                    const QByteArray sample(source->peek(Qrypto::Compress::ProbeSize));
+                    d->compress.adapt(sample.constData(), sample.size(),
+                                      source->isSequential() ? -1 : source->size() - source->pos());
+                }
+
+                if (encryptor)
+                    deflater.reset(d->compress.deflater(d->pipe(encryptor.data(), encryptorPipe),
+                                                        d->compress.deflateLevel(), &d->error));
+
+                if (!encryptor) {
+                    d->status = CryptographicError;
+                } else if (!deflater) {
+                    d->status = CompressionError;
+                } else {
+                    Qrypto::Sink *input = d->pipe(deflater.data(), deflaterPipe);
+                    d->crypticVersion = d->crypticVersion == 3 ? 3 : 2;
+                    payload.open();
+
+                    if (d->read(source, input) && !(d->error = input->close())) {
+                        d->status = Ok;
+                    } else if (d->error) {
+                        deflaterPipe.reset(); // joins the stages before reading their errors
+                        encryptorPipe.reset();
+                        payloadPipe.reset();
+                        d->status = d->failure(encryptor.data(), deflater.data());
+                    }
+                }
+            }
+        }
+    }
+
+    return d->status;
+}
+
 Qrypto::Error QryptIO::error() const
 {
     return d->error;
 }
 
+void QryptIO::setCrypticVersion(int version)
+{
+    d->crypticVersion = version;
+}
+
+bool QryptIO::isPipelined() const
+{
+    return d->pipelined;
+}
+
+void QryptIO::setPipelined(bool pipelined)
+{
+    d->pipelined = pipelined;
+}
+
 Qrypto::KeyMaker &QryptIO::keyMaker()
 {
     return d->keyMaker;
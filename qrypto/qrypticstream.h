@@ -21,6 +21,15 @@ class QryptIO
     struct Private;
     Private *d;
 
+    friend class QryptCache;
+
+    /**
+     * @brief metadata returns the raw Header and Trailer last read, for the QryptCache
+     */
+    void metadata(int &version, QByteArray &header, QByteArray &trailer) const;
+
+    Status setMetadata(int version, const QByteArray &header, const QByteArray &trailer);
+
 public:
     /**
      * @brief The Status enum wanted to use QTextStream::Status, but it needed more statuses
@@ -47,6 +56,16 @@ public:
      */
     Status decrypt(QByteArray &data, const QString &password);
 
+    /**
+     * @brief decrypt data from underlying device in chunks into sink
+     * @param sink
+     * @param password
+     * @return
+     * @note memory use is bounded by the chunk size on random access devices,
+     * sink receives data before it is authenticated, so discard it unless Ok
+     */
+    Status decrypt(QIODevice *sink, const QString &password);
+
     /**
      * @brief encrypt data into underlying device
      * @param data
@@ -55,6 +74,36 @@ public:
      */
     Status encrypt(const QByteArray &data, const QString &password);
 
+    /**
+     * @brief encrypt data from source in chunks into underlying device
+     * @param source
+     * @param password
+     * @return
+     * @note memory use is bounded by the chunk size
+     */
+    Status encrypt(QIODevice *source, const QString &password);
+
+    /**
+     * @brief readHeader loads the key derivation and cipher parameters without the Payload
+     * @return
+     * @note keeps the device position, so decrypt may follow
+     */
+    Status readHeader();
+
+    /**
+     * @brief readTrailer loads the length, authentication and compression parameters,
+     * seeking past the Payload instead of decoding it
+     * @return ReadPastEnd on sequential devices
+     * @note keeps the device position, so decrypt may follow
+     */
+    Status readTrailer();
+
+    /**
+     * @brief length of the plain data, as stated by the Trailer
+     * @return
+     */
+    qint64 length() const;
+
     /**
      * @part 1: Preencryption Datacompression
      * @include qryptocompress.h
@@ -88,6 +137,21 @@ public:
      */
     int crypticVersion();
 
+    /**
+     * @brief setCrypticVersion selects the format for encrypt
+     * @param version 2 for XML (default), 3 for binary DER
+     */
+    void setCrypticVersion(int version);
+
+    bool isPipelined() const;
+
+    /**
+     * @brief setPipelined runs each stage of streaming encrypt and decrypt on its own worker thread
+     * @param pipelined false by default
+     * @note the device is then written or the sink receives data from a worker thread
+     */
+    void setPipelined(bool pipelined);
+
     QIODevice *device() const;
 
     /**
@@ -13,6 +13,7 @@
 #define QRYPTO_QRYPTO_H
 
 #include <QStringList>
+#include <string>
 #include <vector>
 
 namespace Qrypto
@@ -37,14 +38,25 @@ class Compress;
 /// @include qryptokeymaker.h
 class KeyMaker;
 
+/// @include qryptosink.h
+class Sink;
+
 /// @include sequre.h
 template <class Str, typename Len, typename Chr>
 class Sequre;
 
+template <size_t N, typename Chr>
+class SequreArray;
+
+/// @include sequrearena.h
+template <typename T>
+class SequreAllocator;
+
 typedef Sequre<QByteArray, int, char> SequreBytes;
 typedef Sequre<QString, int, QChar> SequreString;
-typedef Sequre<std::string, size_t, char> SequreStr;
-typedef Sequre<std::vector<uchar>, size_t, uchar> SequreData;
+typedef Sequre<std::basic_string<char, std::char_traits<char>, SequreAllocator<char> >, size_t, char> SequreStr;
+typedef Sequre<std::vector<uchar, SequreAllocator<uchar> >, size_t, uchar> SequreData;
+typedef SequreArray<128, uchar> SequreKey;
 
 }
 
@@ -1,14 +1,32 @@
 # DO NOT INCLUDE THIS FILE
 # include either botan.pri or cryptopp.pri
-QT += xml
+QT += concurrent xml
+LIBS += -lbz2 -llz4 -llzma -lzstd
 
 HEADERS += $$PWD/pointerator.h \
            $$PWD/qrypto.h \
+           $$PWD/qrypticcache.h \
            $$PWD/qrypticstream.h \
+           $$PWD/qryptocalibration.h \
            $$PWD/qryptocipher.h \
+           $$PWD/qryptocodec.h \
            $$PWD/qryptocompress.h \
+           $$PWD/qryptoencoding.h \
            $$PWD/qryptokeymaker.h \
-           $$PWD/sequre.h
+           $$PWD/qryptomemoryhard.h \
+           $$PWD/qryptopbkdf2.h \
+           $$PWD/qryptosink.h \
+           $$PWD/sequre.h \
+           $$PWD/sequrearena.h
 
-SOURCES += $$PWD/qrypticstream.cpp \
-           $$PWD/sequre.cpp
+SOURCES += $$PWD/qrypticcache.cpp \
+           $$PWD/qrypticstream.cpp \
+           $$PWD/qryptocalibration.cpp \
+           $$PWD/qryptocodec.cpp \
+           $$PWD/qryptodictionary.cpp \
+           $$PWD/qryptoencoding.cpp \
+           $$PWD/qryptomemoryhard.cpp \
+           $$PWD/qryptopbkdf2.cpp \
+           $$PWD/qryptosink.cpp \
+           $$PWD/sequre.cpp \
+           $$PWD/sequrearena.cpp
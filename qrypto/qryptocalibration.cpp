@@ -0,0 +1,204 @@
+#include "qryptocalibration.h"
+
+#include <QElapsedTimer>
+#include <QFuture>
+#include <QHash>
+#include <QMutex>
+#include <QSettings>
+#include <QSysInfo>
+#include <QThread>
+#include <QtConcurrentRun>
+
+using namespace Qrypto;
+
+namespace
+{
+/// iterations of the first trial, doubled until a trial lasts TrialTime
+const uint FirstCount = 4096;
+
+/// nanoseconds of a trial
+const qint64 TrialTime = 100000000;
+
+/// trials per algorithm, the fastest is kept against the load of the host
+const int Trials = 3;
+
+/**
+ * @brief host identifies the processor the rates were measured on
+ */
+QString host()
+{
+    return QString("%1 %2 %3").arg(QSysInfo::machineHostName(), QSysInfo::currentCpuArchitecture())
+            .arg(QThread::idealThreadCount());
+}
+}
+
+struct KeyCalibration::Impl
+{
+    QMutex mutex;
+    QHash<int, uint> rates;
+    QFuture<void> running;
+    bool loaded;
+
+    Impl() :
+        loaded(false)
+    { }
+
+    /**
+     * @brief load the rates saved for this host, once, with the mutex locked
+     */
+    void load()
+    {
+        if (loaded)
+            return;
+
+        QSettings settings;
+        loaded = true;
+        settings.beginGroup("Calibration");
+
+        if (settings.value("Host").toString() != host())
+            return;
+
+        for (int algorithm = 0; algorithm < KeyMaker::UnknownAlgorithm; ++algorithm) {
+            const uint rate = settings.value(KeyMaker::AlgorithmNames.at(algorithm)).toUInt();
+
+            if (rate)
+                rates.insert(algorithm, rate);
+        }
+    }
+
+    /**
+     * @brief save a rate, with the mutex locked
+     */
+    void save(KeyMaker::Algorithm algorithm, uint rate)
+    {
+        QSettings settings;
+        settings.beginGroup("Calibration");
+
+        if (settings.value("Host").toString() != host()) {
+            settings.remove(QString());
+            settings.setValue("Host", host());
+        }
+
+        settings.setValue(KeyMaker::AlgorithmNames.at(algorithm), rate);
+        rates.insert(algorithm, rate);
+    }
+
+    /**
+     * @brief measure the rate of a key of one block, derived on a single thread
+     * @return iterations per second, 0 on error
+     */
+    static uint measure(KeyMaker::Algorithm algorithm)
+    {
+        const QByteArray password("calibration");
+        KeyMaker keyMaker(algorithm, 1);
+        QElapsedTimer timer;
+        quint64 rate = 0;
+        uint count = FirstCount;
+        keyMaker.setSalt(QByteArray(16, '\x5c')); // not all zeroes, so no random salt is generated
+
+        for (int trial = 0; trial < Trials; ) {
+            keyMaker.setIterationCount(count);
+            timer.start();
+
+            if (keyMaker.deriveKey(password) != NoError)
+                return 0;
+
+            const qint64 elapsed = qMax<qint64>(timer.nsecsElapsed(), 1);
+
+            if (elapsed < TrialTime && count < (1U << 30)) {
+                count *= 2;
+            } else {
+                rate = qMax(rate, quint64(count) * 1000000000 / quint64(elapsed));
+                ++trial;
+            }
+        }
+
+        return uint(qMin<quint64>(rate, 0xFFFFFFFF));
+    }
+};
+
+KeyCalibration::KeyCalibration() :
+    d(new Impl)
+{ }
+
+KeyCalibration::~KeyCalibration()
+{
+    delete d;
+}
+
+KeyCalibration &KeyCalibration::instance()
+{
+    static KeyCalibration *calibration = new KeyCalibration; // outlives a measurement at exit
+    return *calibration;
+}
+
+void KeyCalibration::start()
+{
+    QMutexLocker locker(&d->mutex);
+
+    if (!d->running.isRunning())
+        d->running = QtConcurrent::run(this, &KeyCalibration::calibrate, false);
+}
+
+void KeyCalibration::wait()
+{
+    QMutexLocker locker(&d->mutex);
+    QFuture<void> running(d->running);
+    locker.unlock();
+    running.waitForFinished();
+}
+
+void KeyCalibration::calibrate(bool force)
+{
+    for (int algorithm = 0; algorithm < KeyMaker::UnknownAlgorithm; ++algorithm) {
+        QMutexLocker locker(&d->mutex);
+        d->load();
+
+        if (!force && d->rates.contains(algorithm))
+            continue;
+
+        locker.unlock(); // rates stay readable while measuring
+        const uint rate = Impl::measure(KeyMaker::Algorithm(algorithm));
+        locker.relock();
+
+        if (rate)
+            d->save(KeyMaker::Algorithm(algorithm), rate);
+    }
+}
+
+uint KeyCalibration::rate(KeyMaker::Algorithm algorithm) const
+{
+    QMutexLocker locker(&d->mutex);
+    d->load();
+    return d->rates.value(algorithm);
+}
+
+uint KeyCalibration::iterationCount(const KeyMaker &keyMaker, uint milliseconds) const
+{
+    const quint64 perSecond = rate(keyMaker.algorithm());
+    const uint digestSize = keyMaker.digestSize();
+
+    if (!perSecond || !digestSize)
+        return 0;
+
+    // blocks of the key are derived side by side, as many at a time as threads
+    const uint blocks = qMax((keyMaker.keyLength() + digestSize - 1) / digestSize, 1U);
+    const uint threads = uint(qMax(QThread::idealThreadCount(), 1));
+    const uint rounds = (blocks + threads - 1) / threads;
+    return uint(qBound<quint64>(1, perSecond * milliseconds / 1000 / rounds, 0xFFFFFFFF));
+}
+
+void KeyCalibration::apply(KeyMaker &keyMaker, uint milliseconds) const
+{
+    if (keyMaker.function() != KeyMaker::Pbkdf2)
+        return;
+
+    const uint count = iterationCount(keyMaker, milliseconds);
+
+    if (count) {
+        keyMaker.setIterationTime(0);
+        keyMaker.setIterationCount(count);
+    } else {
+        keyMaker.setIterationTime(milliseconds);
+    }
+}
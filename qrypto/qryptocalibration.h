@@ -0,0 +1,77 @@
+/* Qrypto 2019
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**/
+#ifndef QRYPTO_CALIBRATION_H
+#define QRYPTO_CALIBRATION_H
+
+#include "qryptokeymaker.h"
+
+namespace Qrypto
+{
+
+/**
+ * @brief The KeyCalibration class measures once how many PBKDF2 iterations per second
+ * each KeyMaker::Algorithm runs on this host, and keeps the rates in QSettings
+ * @note thread-safe, rates are discarded when the processor or thread count changes
+ */
+class KeyCalibration
+{
+    struct Impl;
+    Impl *d;
+
+    KeyCalibration();
+    ~KeyCalibration();
+
+    Q_DISABLE_COPY(KeyCalibration)
+
+public:
+    static KeyCalibration &instance();
+
+    /**
+     * @brief start measuring the algorithms without a rate on a thread of the pool
+     * @note the QSettings of the application should be set up before
+     */
+    void start();
+
+    /**
+     * @brief wait for the measurements started by start
+     */
+    void wait();
+
+    /**
+     * @brief calibrate measures the algorithms without a rate, blocking
+     * @param force to measure all algorithms again
+     */
+    void calibrate(bool force = false);
+
+    /**
+     * @brief rate of iterations per second of one hash chain
+     * @return 0 if not calibrated
+     */
+    uint rate(KeyMaker::Algorithm algorithm) const;
+
+    /**
+     * @brief iterationCount for PBKDF2 of keyMaker, with its key length, to last milliseconds
+     * @return 0 if its algorithm is not calibrated
+     */
+    uint iterationCount(const KeyMaker &keyMaker, uint milliseconds) const;
+
+    /**
+     * @brief apply the iterationCount for milliseconds to keyMaker, falling back to its iterationTime
+     * while its algorithm is not calibrated
+     * @note memory-hard functions are left as they are
+     */
+    void apply(KeyMaker &keyMaker, uint milliseconds) const;
+};
+
+}
+
+#endif // QRYPTO_CALIBRATION_H
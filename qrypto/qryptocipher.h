@@ -36,6 +36,8 @@ class Cipher
     QString m_operationCode;
     QByteArray m_authentication;
     QByteArray m_initialVector;
+    int m_segmentSize;
+    quint32 m_segmentCount;
 
 public:
     enum Algorithm {
@@ -59,6 +61,7 @@ public:
         ECB,    // Electronic Codebook
         GCM,    // Galois Counter
         OFB,    // Output Feedback
+        STREAM, // Segmented Galois Counter, segments are crypted in parallel
         UnknownOperation
     };
 
@@ -66,6 +69,11 @@ public:
 
     static const QStringList OperationCodes;
 
+    static const int DefaultSegmentSize = 1048576;
+
+    /// segments of a batch per thread must fit in memory, and their size in a QByteArray
+    static const int MaxSegmentSize = 67108864;
+
     /**
      * @brief Cipher default constructor
      * @param algorithm
@@ -73,12 +81,57 @@ public:
      */
     Cipher(Algorithm algorithm = AES, Operation operation = GCM) :
         m_algorithmName(AlgorithmNames.at(algorithm)),
-        m_operationCode(OperationCodes.at(operation))
+        m_operationCode(OperationCodes.at(operation)),
+        m_segmentSize(DefaultSegmentSize),
+        m_segmentCount(0)
     { }
 
-    Error decrypt(SequreBytes &plain, const QByteArray &crypt, const KeyMaker &keyMaker);
+    /**
+     * @brief decrypt crypt data appending to plain
+     * @param plain result, reserve it in advance to avoid reallocation
+     * @param cryptData
+     * @param cryptSize in bytes
+     * @param keyMaker
+     * @return decryption error
+     */
+    Error decrypt(SequreBytes &plain, const char *cryptData, int cryptSize, const KeyMaker &keyMaker);
 
-    Error encrypt(QByteArray &crypt, const SequreBytes &plain, const KeyMaker &keyMaker);
+    Error decrypt(SequreBytes &plain, const QByteArray &crypt, const KeyMaker &keyMaker)
+    { return decrypt(plain, crypt.constData(), crypt.size(), keyMaker); }
+
+    /**
+     * @brief encrypt plain data into crypt
+     * @param crypt result, replaced while keeping its capacity
+     * @param plainData
+     * @param plainSize in bytes
+     * @param keyMaker
+     * @return encryption error
+     */
+    Error encrypt(QByteArray &crypt, const char *plainData, int plainSize, const KeyMaker &keyMaker);
+
+    Error encrypt(QByteArray &crypt, const SequreBytes &plain, const KeyMaker &keyMaker)
+    { return encrypt(crypt, plain->constData(), plain->size(), keyMaker); }
+
+    /**
+     * @brief decryptor creates a streaming decryption stage
+     * @param sink receives the plain stream
+     * @param keyMaker with derived key, used until the stage is deleted
+     * @param error optional
+     * @return Sink owned by the caller or null on error
+     * @warning the sink receives data before it could be authenticated,
+     * discard it unless the stage closes without error
+     */
+    Sink *decryptor(Sink *sink, const KeyMaker &keyMaker, Error *error = 0);
+
+    /**
+     * @brief encryptor creates a streaming encryption stage
+     * @param sink receives the cryptic stream
+     * @param keyMaker with derived key, used until the stage is deleted
+     * @param error optional
+     * @return Sink owned by the caller or null on error
+     * @note initialVector is generated here and authentication is set on close
+     */
+    Sink *encryptor(Sink *sink, const KeyMaker &keyMaker, Error *error = 0);
 
     /**
      * @brief validateKeyLength
@@ -178,6 +231,30 @@ public:
         else
             m_operationCode.clear();
     }
+
+    /**
+     * @brief segmentCount of STREAM Operation, set by encrypt and verified by decrypt
+     * @return 0 when unknown, like after streaming encryption
+     */
+    quint32 segmentCount() const
+    { return m_segmentCount; }
+
+    void setSegmentCount(quint32 segmentCount)
+    { m_segmentCount = segmentCount; }
+
+    /**
+     * @brief segmentSize of plain data in each STREAM segment
+     * @return
+     */
+    int segmentSize() const
+    { return m_segmentSize; }
+
+    /**
+     * @brief setSegmentSize
+     * @param segmentSize bounded from 1 to MaxSegmentSize
+     */
+    void setSegmentSize(int segmentSize)
+    { m_segmentSize = qBound(1, segmentSize, int(MaxSegmentSize)); } // a copy, MaxSegmentSize has no definition to bind
 };
 
 }
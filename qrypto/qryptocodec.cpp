@@ -0,0 +1,411 @@
+#include "qryptocodec.h"
+
+#include <QThread>
+
+#include <zstd_errors.h>
+
+#include <cstring>
+
+using namespace Qrypto;
+
+static const size_t Lz4ChunkSize = 65536;
+
+static Error zstdError(size_t code, bool decompression)
+{
+    switch (ZSTD_getErrorCode(code)) {
+    case ZSTD_error_memory_allocation:
+        return OutOfMemory;
+    case ZSTD_error_checksum_wrong:
+        return IntegrityError;
+    case ZSTD_error_parameter_unsupported:
+    case ZSTD_error_parameter_outOfBound:
+        return InvalidArgument;
+    default:
+        return decompression ? InvalidFormat : UnknownError;
+    }
+}
+
+Error CodecSink::run(const char *data, size_t size, bool finish)
+{
+    size_t produced = 0;
+
+    if (m_error)
+        return m_error;
+    else if (!m_open && (m_error = open()))
+        return m_error;
+    else if (!size && !finish)
+        return NoError;
+
+    do {
+        if ((m_error = code(data, size, finish, produced)))
+            return m_error;
+
+        if (produced) {
+            const Error error = m_sink->write(m_buffer.constData(), produced);
+
+            if (error)
+                return error;
+        }
+    } while (size > 0 || produced == size_t(m_buffer.size()) || (finish && !m_end));
+
+    return NoError;
+}
+
+Error CodecSink::close()
+{
+    const Error error = run(0, 0, true);
+    return error ? error : m_sink->close();
+}
+
+Bz2Sink::Bz2Sink(Sink *sink, int blockSize, bool decompression) :
+    CodecSink(sink, decompression),
+    m_blockSize(qBound(1, blockSize, 9))
+{
+    std::memset(&m_bz, 0, sizeof m_bz);
+}
+
+Bz2Sink::~Bz2Sink()
+{
+    if (m_open && m_decompression)
+        BZ2_bzDecompressEnd(&m_bz);
+    else if (m_open)
+        BZ2_bzCompressEnd(&m_bz);
+}
+
+Error Bz2Sink::open()
+{
+    const int ret = m_decompression ? BZ2_bzDecompressInit(&m_bz, 0, 0) :
+                                      BZ2_bzCompressInit(&m_bz, m_blockSize, 0, 0);
+    m_open = ret == BZ_OK;
+    m_end = false;
+
+    switch (ret) {
+    case BZ_OK:
+        return NoError;
+    case BZ_MEM_ERROR:
+        return OutOfMemory;
+    case BZ_PARAM_ERROR:
+        return InvalidArgument;
+    default:
+        return UnknownError;
+    }
+}
+
+Error Bz2Sink::code(const char *&data, size_t &size, bool finish, size_t &produced)
+{
+    int ret;
+    produced = 0;
+
+    if (m_end && (!m_decompression || !size))
+        return NoError;
+    else if (!m_decompression && !finish && !size) // BZ_RUN without input is a parameter error
+        return NoError;
+
+    if (m_end) { // concatenated stream
+        BZ2_bzDecompressEnd(&m_bz);
+        m_open = false;
+
+        if (const Error error = open())
+            return error;
+    }
+
+    m_bz.next_in = const_cast<char*>(data);
+    m_bz.avail_in = uint(size);
+    m_bz.next_out = m_buffer.data();
+    m_bz.avail_out = uint(m_buffer.size());
+
+    if (m_decompression)
+        ret = BZ2_bzDecompress(&m_bz);
+    else
+        ret = BZ2_bzCompress(&m_bz, finish ? BZ_FINISH : BZ_RUN);
+
+    produced = m_buffer.size() - m_bz.avail_out;
+    data += size - m_bz.avail_in;
+    size = m_bz.avail_in;
+    m_end = ret == BZ_STREAM_END;
+
+    switch (ret) {
+    case BZ_OK:
+    case BZ_RUN_OK:
+    case BZ_FINISH_OK:
+    case BZ_STREAM_END:
+        return finish && m_decompression && !m_end && !produced ? InvalidFormat : NoError; // truncated
+    case BZ_MEM_ERROR:
+        return OutOfMemory;
+    case BZ_DATA_ERROR:
+    case BZ_DATA_ERROR_MAGIC:
+        return InvalidFormat;
+    default:
+        return UnknownError;
+    }
+}
+
+LzmaSink::LzmaSink(Sink *sink, int preset, bool decompression, quint64 blockSize) :
+    CodecSink(sink, decompression),
+    m_preset(qBound(0, preset, 9)),
+    m_blockSize(blockSize)
+{
+    const lzma_stream init = LZMA_STREAM_INIT;
+    m_lzma = init;
+}
+
+LzmaSink::~LzmaSink()
+{
+    lzma_end(&m_lzma);
+}
+
+Error LzmaSink::open()
+{
+    lzma_mt mt;
+    lzma_ret ret;
+    std::memset(&mt, 0, sizeof mt);
+    mt.threads = qMax(1, QThread::idealThreadCount());
+
+    if (m_decompression) {
+#if LZMA_VERSION >= 50040002
+        mt.flags = LZMA_CONCATENATED;
+        mt.memlimit_threading = lzma_physmem() / 4;
+        mt.memlimit_stop = UINT64_MAX;
+        ret = lzma_stream_decoder_mt(&m_lzma, &mt);
+#else
+        ret = lzma_stream_decoder(&m_lzma, UINT64_MAX, LZMA_CONCATENATED);
+#endif
+    } else {
+        mt.preset = m_preset;
+        mt.block_size = m_blockSize;
+        mt.check = LZMA_CHECK_CRC64;
+        ret = lzma_stream_encoder_mt(&m_lzma, &mt);
+    }
+
+    m_open = ret == LZMA_OK;
+    m_end = false;
+
+    switch (ret) {
+    case LZMA_OK:
+        return NoError;
+    case LZMA_MEM_ERROR:
+        return OutOfMemory;
+    case LZMA_OPTIONS_ERROR:
+        return InvalidArgument;
+    case LZMA_UNSUPPORTED_CHECK:
+        return NotImplemented;
+    default:
+        return UnknownError;
+    }
+}
+
+Error LzmaSink::code(const char *&data, size_t &size, bool finish, size_t &produced)
+{
+    produced = 0;
+
+    if (m_end)
+        return size ? InvalidFormat : NoError;
+
+    m_lzma.next_in = reinterpret_cast<const uint8_t*>(data);
+    m_lzma.avail_in = size;
+    m_lzma.next_out = reinterpret_cast<uint8_t*>(m_buffer.data());
+    m_lzma.avail_out = m_buffer.size();
+
+    const lzma_ret ret = lzma_code(&m_lzma, finish ? LZMA_FINISH : LZMA_RUN);
+
+    produced = m_buffer.size() - m_lzma.avail_out;
+    data += size - m_lzma.avail_in;
+    size = m_lzma.avail_in;
+    m_end = ret == LZMA_STREAM_END;
+
+    switch (ret) {
+    case LZMA_OK:
+    case LZMA_STREAM_END:
+        return NoError;
+    case LZMA_MEM_ERROR:
+    case LZMA_MEMLIMIT_ERROR:
+        return OutOfMemory;
+    case LZMA_FORMAT_ERROR:
+    case LZMA_DATA_ERROR:
+    case LZMA_BUF_ERROR:
+        return InvalidFormat;
+    case LZMA_OPTIONS_ERROR:
+    case LZMA_UNSUPPORTED_CHECK:
+        return NotImplemented;
+    default:
+        return UnknownError;
+    }
+}
+
+Lz4Sink::Lz4Sink(Sink *sink, int level, bool decompression) :
+    CodecSink(sink, decompression),
+    m_cctx(0),
+    m_begun(false)
+{
+    std::memset(&m_preferences, 0, sizeof m_preferences);
+    m_preferences.compressionLevel = qBound(0, level, 12);
+    m_preferences.frameInfo.contentChecksumFlag = LZ4F_contentChecksumEnabled;
+}
+
+Lz4Sink::~Lz4Sink()
+{
+    if (m_open && m_decompression)
+        LZ4F_freeDecompressionContext(m_dctx);
+    else if (m_open)
+        LZ4F_freeCompressionContext(m_cctx);
+}
+
+Error Lz4Sink::open()
+{
+    LZ4F_errorCode_t ret;
+
+    if (m_decompression) {
+        ret = LZ4F_createDecompressionContext(&m_dctx, LZ4F_VERSION);
+    } else {
+        ret = LZ4F_createCompressionContext(&m_cctx, LZ4F_VERSION);
+        m_buffer.resize(int(LZ4F_HEADER_SIZE_MAX + LZ4F_compressBound(Lz4ChunkSize, &m_preferences)));
+    }
+
+    m_open = !LZ4F_isError(ret);
+    m_begun = false;
+    m_end = false;
+    return m_open ? NoError : OutOfMemory;
+}
+
+Error Lz4Sink::code(const char *&data, size_t &size, bool finish, size_t &produced)
+{
+    char *buffer = m_buffer.data();
+    const size_t capacity = m_buffer.size();
+    size_t ret;
+    produced = 0;
+
+    if (m_end && (!m_decompression || !size))
+        return NoError;
+
+    if (m_decompression) {
+        size_t consumed = size;
+        produced = capacity;
+        ret = LZ4F_decompress(m_dctx, buffer, &produced, data, &consumed, 0);
+
+        if (LZ4F_isError(ret))
+            return InvalidFormat;
+
+        data += consumed;
+        size -= consumed;
+        m_end = ret == 0;
+        return finish && !m_end && !produced && !consumed ? InvalidFormat : NoError; // truncated
+    }
+
+    if (!m_begun) {
+        ret = LZ4F_compressBegin(m_cctx, buffer, capacity, &m_preferences);
+
+        if (LZ4F_isError(ret))
+            return InvalidArgument;
+
+        produced = ret;
+        m_begun = true;
+    }
+
+    if (const size_t chunk = qMin(size, Lz4ChunkSize)) { // the buffer is bound for a chunk
+        ret = LZ4F_compressUpdate(m_cctx, buffer + produced, capacity - produced, data, chunk, 0);
+
+        if (LZ4F_isError(ret))
+            return UnknownError;
+
+        produced += ret;
+        data += chunk;
+        size -= chunk;
+    }
+
+    if (finish && !size) {
+        ret = LZ4F_compressEnd(m_cctx, buffer + produced, capacity - produced, 0);
+
+        if (LZ4F_isError(ret))
+            return UnknownError;
+
+        produced += ret;
+        m_end = true;
+    }
+
+    return NoError;
+}
+
+ZstdSink::ZstdSink(Sink *sink, int level, bool decompression, bool longDistance, const QByteArray &dictionary,
+                   int workers) :
+    CodecSink(sink, decompression),
+    m_cctx(0),
+    m_level(qBound(ZSTD_minCLevel(), level, ZSTD_maxCLevel())),
+    m_longDistance(longDistance),
+    m_dictionary(dictionary),
+    m_workers(qMax(workers, 0))
+{ }
+
+ZstdSink::~ZstdSink()
+{
+    if (m_decompression)
+        ZSTD_freeDCtx(m_dctx);
+    else
+        ZSTD_freeCCtx(m_cctx);
+}
+
+Error ZstdSink::open()
+{
+    size_t ret = 0;
+
+    if (m_decompression) {
+        if (!m_dctx && !(m_dctx = ZSTD_createDCtx()))
+            return OutOfMemory;
+
+        if (!m_dictionary.isEmpty())
+            ret = ZSTD_DCtx_loadDictionary(m_dctx, m_dictionary.constData(), m_dictionary.size());
+    } else {
+        if (!m_cctx && !(m_cctx = ZSTD_createCCtx()))
+            return OutOfMemory;
+
+        ZSTD_CCtx_setParameter(m_cctx, ZSTD_c_nbWorkers, m_workers); // fails without threads
+        ret = ZSTD_CCtx_setParameter(m_cctx, ZSTD_c_compressionLevel, m_level);
+
+        if (!ZSTD_isError(ret))
+            ret = ZSTD_CCtx_setParameter(m_cctx, ZSTD_c_checksumFlag, 1);
+
+        if (!ZSTD_isError(ret) && m_longDistance) {
+            ret = ZSTD_CCtx_setParameter(m_cctx, ZSTD_c_enableLongDistanceMatching, 1);
+
+            if (!ZSTD_isError(ret))
+                ret = ZSTD_CCtx_setParameter(m_cctx, ZSTD_c_windowLog, 27); // decoded within the default limit
+        }
+
+        if (!ZSTD_isError(ret) && !m_dictionary.isEmpty())
+            ret = ZSTD_CCtx_loadDictionary(m_cctx, m_dictionary.constData(), m_dictionary.size());
+    }
+
+    m_open = !ZSTD_isError(ret);
+    m_end = false;
+    return m_open ? NoError : zstdError(ret, false);
+}
+
+Error ZstdSink::code(const char *&data, size_t &size, bool finish, size_t &produced)
+{
+    ZSTD_inBuffer input = { data, size, 0 };
+    ZSTD_outBuffer output = { m_buffer.data(), size_t(m_buffer.size()), 0 };
+    size_t ret;
+    produced = 0;
+
+    if (m_end && (!m_decompression || !size))
+        return NoError;
+
+    if (m_decompression)
+        ret = ZSTD_decompressStream(m_dctx, &output, &input);
+    else
+        ret = ZSTD_compressStream2(m_cctx, &output, &input, finish ? ZSTD_e_end : ZSTD_e_continue);
+
+    if (ZSTD_isError(ret))
+        return zstdError(ret, m_decompression);
+
+    produced = output.pos;
+    data += input.pos;
+    size -= input.pos;
+
+    if (m_decompression) {
+        m_end = ret == 0;
+        return finish && !m_end && !produced && !input.pos ? InvalidFormat : NoError; // truncated
+    }
+
+    m_end = finish && ret == 0;
+    return NoError;
+}
@@ -0,0 +1,193 @@
+/* Qrypto 2019
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** libbzip2 is licensed under BSD-style license
+** liblzma is in the public domain
+** LZ4 and Zstandard are licensed under BSD License
+**/
+#ifndef QRYPTO_CODEC_H
+#define QRYPTO_CODEC_H
+
+#include "qryptosink.h"
+
+#include <bzlib.h>
+#include <lz4frame.h>
+#include <lzma.h>
+#include <zstd.h>
+
+namespace Qrypto
+{
+
+/**
+ * @brief The CodecSink class drives the stream of a compression library into the next Sink
+ */
+class CodecSink : public Sink
+{
+protected:
+    Sink *m_sink;
+    QByteArray m_buffer;
+    bool m_decompression;
+    bool m_open;
+    bool m_end;
+
+    /**
+     * @brief code consumes input and fills the buffer
+     * @param data input, advanced past consumed bytes
+     * @param size of input, reduced by consumed bytes
+     * @param finish no more input will follow
+     * @param produced bytes in the buffer
+     * @return error raised by the library
+     */
+    virtual Error code(const char *&data, size_t &size, bool finish, size_t &produced) = 0;
+
+    Error run(const char *data, size_t size, bool finish);
+
+public:
+    CodecSink(Sink *sink, bool decompression) :
+        m_sink(sink),
+        m_buffer(65536, Qt::Uninitialized),
+        m_decompression(decompression),
+        m_open(false),
+        m_end(false)
+    { }
+
+    /**
+     * @brief open initialises the library stream
+     * @return error of initialisation
+     */
+    virtual Error open() = 0;
+
+    Error write(const char *data, qint64 size)
+    { return run(data, size, false); }
+
+    Error close();
+};
+
+/**
+ * @brief The Bz2Sink class compresses into or decompresses from concatenated bzip2 streams
+ */
+class Bz2Sink : public CodecSink
+{
+    bz_stream m_bz;
+    int m_blockSize;
+
+protected:
+    Error code(const char *&data, size_t &size, bool finish, size_t &produced);
+
+public:
+    /**
+     * @brief Bz2Sink
+     * @param sink receives the result
+     * @param blockSize 1 to 9 in 100 kB
+     * @param decompression
+     */
+    Bz2Sink(Sink *sink, int blockSize, bool decompression);
+
+    ~Bz2Sink();
+
+    Error open();
+};
+
+/**
+ * @brief The LzmaSink class compresses into or decompresses from xz streams using multiple threads
+ */
+class LzmaSink : public CodecSink
+{
+    lzma_stream m_lzma;
+    int m_preset;
+    quint64 m_blockSize;
+
+protected:
+    Error code(const char *&data, size_t &size, bool finish, size_t &produced);
+
+public:
+    /**
+     * @brief LzmaSink
+     * @param sink receives the result
+     * @param preset 0 to 9
+     * @param decompression
+     * @param blockSize of uncompressed data per thread, 0 by default of the preset
+     */
+    LzmaSink(Sink *sink, int preset, bool decompression, quint64 blockSize = 0);
+
+    ~LzmaSink();
+
+    Error open();
+};
+
+/**
+ * @brief The Lz4Sink class compresses into or decompresses from concatenated LZ4 frames
+ */
+class Lz4Sink : public CodecSink
+{
+    union {
+        LZ4F_cctx *m_cctx;
+        LZ4F_dctx *m_dctx;
+    };
+    LZ4F_preferences_t m_preferences;
+    bool m_begun;
+
+protected:
+    Error code(const char *&data, size_t &size, bool finish, size_t &produced);
+
+public:
+    /**
+     * @brief Lz4Sink
+     * @param sink receives the result
+     * @param level 0 to 2 for the fast compressor, up to 12 for LZ4HC
+     * @param decompression
+     */
+    Lz4Sink(Sink *sink, int level, bool decompression);
+
+    ~Lz4Sink();
+
+    Error open();
+};
+
+/**
+ * @brief The ZstdSink class compresses into or decompresses from concatenated Zstandard frames
+ * @note compresses with workers when libzstd is built with threads
+ */
+class ZstdSink : public CodecSink
+{
+    union {
+        ZSTD_CCtx *m_cctx;
+        ZSTD_DCtx *m_dctx;
+    };
+    int m_level;
+    bool m_longDistance;
+    QByteArray m_dictionary;
+    int m_workers;
+
+protected:
+    Error code(const char *&data, size_t &size, bool finish, size_t &produced);
+
+public:
+    /**
+     * @brief ZstdSink
+     * @param sink receives the result
+     * @param level ZSTD_minCLevel() to ZSTD_maxCLevel(), 0 by default of libzstd
+     * @param decompression
+     * @param longDistance matching over a 128 MiB window, for huge documents
+     * @param dictionary raw content preceding the data, on compression and decompression alike
+     * @param workers threads of libzstd compressing a single stream, 0 within the calling thread
+     */
+    ZstdSink(Sink *sink, int level, bool decompression, bool longDistance = false,
+             const QByteArray &dictionary = QByteArray(), int workers = 0);
+
+    ~ZstdSink();
+
+    Error open();
+};
+
+}
+
+#endif // QRYPTO_CODEC_H
@@ -11,6 +11,9 @@
 **
 ** Botan 1.11 is licensed under Simplified BSD License
 ** CryptoPP 5.6.2 is licensed under Boost Software License 1.0
+** libbzip2 is licensed under BSD-style license
+** liblzma is in the public domain
+** LZ4 and Zstandard are licensed under BSD License
 **/
 #ifndef QRYPTO_COMPRESS_H
 #define QRYPTO_COMPRESS_H
@@ -29,6 +32,11 @@ class Compress
     friend struct Impl;
 
     QString m_algorithmName;
+    QList<int> m_members;
+    int m_memberSize;
+    int m_deflateLevel;
+    uint m_deflateTime;
+    int m_dictionary;
 
 public:
     enum Algorithm {
@@ -36,34 +44,100 @@ public:
         Deflate,
         GZip,
         Identity,
+        Lz4,
         Lzma,
         ZLib,
+        Zstd,
         UnknownAlgorithm
     };
 
+    /**
+     * @brief The Dictionary enum identifies the preset dictionaries shipped with Qrypto
+     * @note ids are recorded in documents, never renumber them
+     */
+    enum Dictionary {
+        NoDictionary,
+        QtHtmlDictionary ///< QTextDocument::toHtml boilerplate
+    };
+
     static const QStringList AlgorithmNames;
 
+    /// bytes of data sampled by adapt
+    static const int ProbeSize = 262144;
+
     Compress(Algorithm algorithm = ZLib) :
-        m_algorithmName(AlgorithmNames.at(algorithm))
+        m_algorithmName(AlgorithmNames.at(algorithm)),
+        m_memberSize(0),
+        m_deflateLevel(6),
+        m_deflateTime(0),
+        m_dictionary(NoDictionary)
     { }
 
+    /**
+     * @brief dictionaryContent of a preset dictionary
+     * @param dictionary id
+     * @return empty for NoDictionary or an unknown id
+     */
+    static QByteArray dictionaryContent(int dictionary);
+
+    /**
+     * @brief adapt the algorithm and deflateLevel to data when deflateTime is set
+     * @param data sample of the start of the data, or all of it
+     * @param size of the sample
+     * @param total size of the data, negative if unknown
+     * @note chooses Identity when the entropy of the sample is too high to compress,
+     * otherwise the strongest of Lz4, Zstd and Lzma estimated to deflate within deflateTime
+     */
+    void adapt(const char *data, int size, qint64 total = -1);
+
     /**
      * @brief deflate data into compressed
      * @param deflated result
      * @param data to defalte
-     * @param deflateLevel 0 to 9
+     * @param size in bytes
+     * @param deflateLevel 0 to 9, up to 12 for Lz4 and 22 for Zstd
      * @return deflation error
+     * @note sets members when compressing multiple members in parallel,
+     * Zstd matches over a long distance in huge data
      */
-    Error deflate(SequreBytes &deflated, const QByteArray &data, int deflateLevel = 6);
+    Error deflate(SequreBytes &deflated, const char *data, int size, int deflateLevel = 6);
+
+    Error deflate(SequreBytes &deflated, const QByteArray &data, int deflateLevel = 6)
+    { return deflate(deflated, data.constData(), data.size(), deflateLevel); }
 
     /**
      * @brief inflate data from compressed
-     * @param inflated result
+     * @param inflated result, reserve it in advance when the inflated size is known
      * @param data to inflate
+     * @param size in bytes
      * @param repeat decompress multiple streams in series
      * @return inflation error
+     * @note decompresses members in parallel when they are known
+     */
+    Error inflate(SequreBytes &inflated, const char *data, int size, bool repeat = false);
+
+    Error inflate(SequreBytes &inflated, const QByteArray &data, bool repeat = false)
+    { return inflate(inflated, data.constData(), data.size(), repeat); }
+
+    /**
+     * @brief deflater creates a streaming compression stage
+     * @param sink receives the compressed stream
+     * @param deflateLevel 0 to 9, up to 12 for Lz4 and 22 for Zstd
+     * @param error optional
+     * @return Sink owned by the caller or null on error
+     * @note compresses batches of members in parallel when memberSize is set
+     */
+    Sink *deflater(Sink *sink, int deflateLevel = 6, Error *error = 0);
+
+    /**
+     * @brief inflater creates a streaming decompression stage
+     * @param sink receives the decompressed stream
+     * @param repeat decompress multiple streams in series
+     * @param error optional
+     * @return Sink owned by the caller or null on error
+     * @note decompresses batches of members in parallel when they are known
      */
-    Error inflate(SequreBytes &inflated, const QByteArray &data, bool repeat = false);
+    Sink *inflater(Sink *sink, bool repeat = false, Error *error = 0);
 
     Algorithm algorithm() const
     {
@@ -88,6 +162,59 @@ public:
         else
             m_algorithmName.clear();
     }
+
+    /**
+     * @brief members compressed sizes of independent members, like pigz but indexed
+     * @return empty for a single member
+     */
+    QList<int> members() const
+    { return m_members; }
+
+    void setMembers(const QList<int> &members)
+    { m_members = members; }
+
+    /**
+     * @brief memberSize of plain data compressed as an independent member
+     * @return 0 to compress a single member, default, except the 900 kB block of Bz2
+     * @note Lzma compresses blocks of memberSize in parallel within a single xz stream instead
+     * @warning readers before the Members index would stop after the first ZLib or Deflate member
+     */
+    int memberSize() const
+    { return m_memberSize || algorithm() != Bz2 ? m_memberSize : 900000; }
+
+    void setMemberSize(int memberSize)
+    { m_memberSize = qMax(0, memberSize); }
+
+    /**
+     * @brief deflateLevel is 6 by default, or chosen by adapt
+     * @return
+     */
+    int deflateLevel() const
+    { return m_deflateLevel; }
+
+    void setDeflateLevel(int deflateLevel)
+    { m_deflateLevel = deflateLevel; }
+
+    /**
+     * @brief deflateTime is 0 milliseconds by default (disabled)
+     * @return
+     */
+    uint deflateTime() const
+    { return m_deflateTime; }
+
+    void setDeflateTime(uint milliseconds)
+    { m_deflateTime = milliseconds; }
+
+    /**
+     * @brief dictionary preset for Zstd, ignored by other algorithms
+     * @return NoDictionary by default
+     * @note an unknown id fails with NotImplemented
+     */
+    int dictionary() const
+    { return m_dictionary; }
+
+    void setDictionary(int dictionary)
+    { m_dictionary = dictionary; }
 };
 
 }
@@ -0,0 +1,60 @@
+#include "qryptocompress.h"
+
+using namespace Qrypto;
+
+/**
+ * @brief QtHtml is raw content in the order of QTextDocument::toHtml output,
+ * the most frequent markup last, nearest to the data
+ * @warning documents refer to it by id, append a new dictionary instead of editing it
+ */
+static const char QtHtml[] =
+        "<table border=\"0\" style=\"-qt-table-type: root; margin-top:4px; margin-bottom:4px; "
+        "margin-left:4px; margin-right:4px;\">\n<tr>\n<td style=\"border: none;\">\n"
+        "<table border=\"1\" style=\" margin-top:0px; margin-bottom:0px; margin-left:0px; margin-right:0px;\" "
+        "width=\"100%\" cellspacing=\"2\" cellpadding=\"0\">\n<tr>\n<td>\n</td></tr></table></td></tr></table>\n"
+        "<img src=\"\" width=\"\" height=\"\" /><hr />"
+        "<span style=\" font-family:'Monospace';\"><span style=\" font-family:'MS Shell Dlg 2';\">"
+        "<span style=\" font-size:8.25pt;\"><span style=\" font-size:10pt;\"><span style=\" font-size:12pt;\">"
+        "<span style=\" text-decoration: line-through;\"><span style=\" vertical-align:super;\">"
+        "<span style=\" vertical-align:sub;\"><span style=\" color:#000000;\"><span style=\" color:#ff0000;\">"
+        "<span style=\" background-color:#ffff00;\">"
+        "<a href=\"http://\"><span style=\" text-decoration: underline; color:#0000ff;\">"
+        "<h1 style=\" margin-top:18px; margin-bottom:12px; margin-left:0px; margin-right:0px; "
+        "-qt-block-indent:0; text-indent:0px;\"><span style=\" font-size:xx-large; font-weight:600;\">"
+        "<h2 style=\" margin-top:16px; margin-bottom:12px; margin-left:0px; margin-right:0px; "
+        "-qt-block-indent:0; text-indent:0px;\"><span style=\" font-size:x-large; font-weight:600;\">"
+        "<h3 style=\" margin-top:14px; margin-bottom:12px; margin-left:0px; margin-right:0px; "
+        "-qt-block-indent:0; text-indent:0px;\"><span style=\" font-size:large; font-weight:600;\">"
+        "<p align=\"center\" style=\" margin-top:0px; margin-bottom:0px; margin-left:0px; margin-right:0px; "
+        "-qt-block-indent:0; text-indent:0px;\">"
+        "<p align=\"right\" style=\" margin-top:0px; margin-bottom:0px; margin-left:0px; margin-right:0px; "
+        "-qt-block-indent:0; text-indent:0px;\">"
+        "<ol style=\"margin-top: 0px; margin-bottom: 0px; margin-left: 0px; margin-right: 0px; "
+        "-qt-list-indent: 1;\"><li style=\" margin-top:0px; margin-bottom:0px; margin-left:0px; "
+        "margin-right:0px; -qt-block-indent:0; text-indent:0px;\"></li></ol>\n"
+        "<ul style=\"margin-top: 0px; margin-bottom: 0px; margin-left: 0px; margin-right: 0px; "
+        "-qt-list-indent: 1;\"><li style=\" margin-top:12px; margin-bottom:0px; margin-left:0px; "
+        "margin-right:0px; -qt-block-indent:0; text-indent:0px;\"></li>\n"
+        "<li style=\" margin-top:0px; margin-bottom:0px; margin-left:0px; margin-right:0px; "
+        "-qt-block-indent:0; text-indent:0px;\"></li></ul>\n"
+        "<span style=\" font-style:italic;\"></span><span style=\" text-decoration: underline;\"></span>"
+        "<span style=\" font-weight:600;\"></span><span style=\" font-weight:600; font-style:italic;\"></span>"
+        "<!DOCTYPE HTML PUBLIC \"-//W3C//DTD HTML 4.0//EN\" \"http://www.w3.org/TR/REC-html40/strict.dtd\">\n"
+        "<html><head><meta name=\"qrichtext\" content=\"1\" /><style type=\"text/css\">\n"
+        "p, li { white-space: pre-wrap; }\n"
+        "</style></head><body style=\" font-family:'Sans Serif'; font-size:9pt; font-weight:400; "
+        "font-style:normal;\">\n"
+        "<p style=\"-qt-paragraph-type:empty; margin-top:0px; margin-bottom:0px; margin-left:0px; "
+        "margin-right:0px; -qt-block-indent:0; text-indent:0px;\"><br /></p>\n"
+        "<p style=\" margin-top:0px; margin-bottom:0px; margin-left:0px; margin-right:0px; "
+        "-qt-block-indent:0; text-indent:0px;\"></p></body></html>";
+
+QByteArray Compress::dictionaryContent(int dictionary)
+{
+    switch (dictionary) {
+    case QtHtmlDictionary:
+        return QByteArray::fromRawData(QtHtml, sizeof QtHtml - 1);
+    default:
+        return QByteArray();
+    }
+}
@@ -0,0 +1,494 @@
+#include "qryptoencoding.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(Q_PROCESSOR_X86) && (defined(Q_CC_GNU) || defined(Q_CC_CLANG))
+#define QRYPTO_ENCODING_X86
+#include <immintrin.h>
+#endif
+
+using namespace Qrypto;
+
+namespace
+{
+enum Level {
+    Scalar,
+    Sse41,
+    Avx2
+};
+
+const char Base64Digits[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+const char HexDigits[] = "0123456789abcdef";
+
+/// values of Decode beside digits
+const uchar Space = 0xFE;
+const uchar Invalid = 0xFF;
+
+/**
+ * @brief The Decode struct maps characters to digit values
+ */
+struct Decode
+{
+    uchar base64[256];
+    uchar hex[256];
+
+    Decode()
+    {
+        std::memset(base64, Invalid, sizeof base64);
+        std::memset(hex, Invalid, sizeof hex);
+
+        for (int digit = 0; digit < 64; ++digit)
+            base64[uchar(Base64Digits[digit])] = uchar(digit);
+
+        for (int digit = 0; digit < 16; ++digit)
+            hex[uchar(HexDigits[digit])] = hex[uchar(HexDigits[digit] & ~0x20)] = uchar(digit);
+
+        const char spaces[] = " \t\n\r\v\f";
+
+        for (const char *space = spaces; *space; ++space)
+            base64[uchar(*space)] = hex[uchar(*space)] = Space;
+    }
+};
+
+const Decode Decoding;
+
+char *toBase64Scalar(char *text, const uchar *data, size_t size)
+{
+    for (; size >= 3; size -= 3, data += 3) {
+        const uint bits = uint(data[0]) << 16 | uint(data[1]) << 8 | data[2];
+        *text++ = Base64Digits[bits >> 18];
+        *text++ = Base64Digits[bits >> 12 & 63];
+        *text++ = Base64Digits[bits >> 6 & 63];
+        *text++ = Base64Digits[bits & 63];
+    }
+
+    if (size) {
+        const uint bits = uint(data[0]) << 16 | (size > 1 ? uint(data[1]) << 8 : 0);
+        *text++ = Base64Digits[bits >> 18];
+        *text++ = Base64Digits[bits >> 12 & 63];
+        *text++ = size > 1 ? Base64Digits[bits >> 6 & 63] : '=';
+        *text++ = '=';
+    }
+
+    return text;
+}
+
+char *toHexScalar(char *text, const uchar *data, size_t size)
+{
+    for (; size--; ++data) {
+        *text++ = HexDigits[*data >> 4];
+        *text++ = HexDigits[*data & 15];
+    }
+
+    return text;
+}
+
+#ifdef QRYPTO_ENCODING_X86
+/* Base64 blocks after Wojciech Muła and Daniel Lemire, Faster Base64 Encoding and Decoding
+ * using AVX2 Instructions, the 128-bit lanes of AVX2 work as SSE registers side by side
+ */
+
+__attribute__((target("sse4.1")))
+inline __m128i toBase64Block(__m128i data)
+{
+    const __m128i in = _mm_shuffle_epi8(data, _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+    const __m128i ac = _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0FC0FC00)), _mm_set1_epi32(0x04000040));
+    const __m128i bd = _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003F03F0)), _mm_set1_epi32(0x01000010));
+    const __m128i digits = _mm_or_si128(ac, bd);
+    __m128i shift = _mm_subs_epu8(digits, _mm_set1_epi8(51));
+    shift = _mm_or_si128(shift, _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), digits), _mm_set1_epi8(13)));
+    shift = _mm_shuffle_epi8(_mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                           '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0),
+                             shift);
+    return _mm_add_epi8(digits, shift);
+}
+
+__attribute__((target("sse4.1")))
+char *toBase64Sse41(char *text, const uchar *data, size_t size)
+{
+    for (; size >= 16; size -= 12, data += 12, text += 16) {
+        const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(text), toBase64Block(in));
+    }
+
+    return toBase64Scalar(text, data, size);
+}
+
+__attribute__((target("avx2")))
+char *toBase64Avx2(char *text, const uchar *data, size_t size)
+{
+    const __m256i order = _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+                                           1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+    const __m256i shifts = _mm256_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                            '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+                                            'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                            '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+
+    for (; size >= 28; size -= 24, data += 24, text += 32) {
+        const __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+        const __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 12));
+        const __m256i in = _mm256_shuffle_epi8(_mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1), order);
+        const __m256i ac = _mm256_mulhi_epu16(_mm256_and_si256(in, _mm256_set1_epi32(0x0FC0FC00)),
+                                              _mm256_set1_epi32(0x04000040));
+        const __m256i bd = _mm256_mullo_epi16(_mm256_and_si256(in, _mm256_set1_epi32(0x003F03F0)),
+                                              _mm256_set1_epi32(0x01000010));
+        const __m256i digits = _mm256_or_si256(ac, bd);
+        __m256i shift = _mm256_subs_epu8(digits, _mm256_set1_epi8(51));
+        shift = _mm256_or_si256(shift, _mm256_and_si256(_mm256_cmpgt_epi8(_mm256_set1_epi8(26), digits),
+                                                        _mm256_set1_epi8(13)));
+        shift = _mm256_shuffle_epi8(shifts, shift);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(text), _mm256_add_epi8(digits, shift));
+    }
+
+    return toBase64Sse41(text, data, size);
+}
+
+/**
+ * @brief fromBase64Sse41 decodes 16 digits into 12 bytes
+ * @return false if any character is not a digit
+ */
+__attribute__((target("sse4.1")))
+inline bool fromBase64Sse41(uchar *data, const char *text)
+{
+    const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text));
+    const __m128i mask = _mm_set1_epi8(0x2F);
+    const __m128i hiNibbles = _mm_and_si128(_mm_srli_epi32(in, 4), mask);
+    const __m128i lo = _mm_shuffle_epi8(_mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                                      0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A),
+                                        _mm_and_si128(in, mask));
+    const __m128i hi = _mm_shuffle_epi8(_mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                                      0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10),
+                                        hiNibbles);
+
+    if (!_mm_testz_si128(lo, hi))
+        return false;
+
+    const __m128i roll = _mm_shuffle_epi8(_mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0),
+                                          _mm_add_epi8(_mm_cmpeq_epi8(in, mask), hiNibbles));
+    const __m128i ab = _mm_maddubs_epi16(_mm_add_epi8(in, roll), _mm_set1_epi32(0x01400140));
+    const __m128i abcd = _mm_shuffle_epi8(_mm_madd_epi16(ab, _mm_set1_epi32(0x00011000)),
+                                          _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+    uchar block[16];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(block), abcd);
+    std::memcpy(data, block, 12);
+    return true;
+}
+
+/**
+ * @brief fromBase64Avx2 decodes 32 digits into 24 bytes
+ * @return false if any character is not a digit
+ */
+__attribute__((target("avx2")))
+inline bool fromBase64Avx2(uchar *data, const char *text)
+{
+    const __m256i in = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(text));
+    const __m256i mask = _mm256_set1_epi8(0x2F);
+    const __m256i hiNibbles = _mm256_and_si256(_mm256_srli_epi32(in, 4), mask);
+    const __m256i lo = _mm256_shuffle_epi8(_mm256_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                                            0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+                                                            0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                                            0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A),
+                                           _mm256_and_si256(in, mask));
+    const __m256i hi = _mm256_shuffle_epi8(_mm256_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                                            0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+                                                            0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                                            0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10),
+                                           hiNibbles);
+
+    if (!_mm256_testz_si256(lo, hi))
+        return false;
+
+    const __m256i roll = _mm256_shuffle_epi8(_mm256_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+                                                              0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0),
+                                             _mm256_add_epi8(_mm256_cmpeq_epi8(in, mask), hiNibbles));
+    const __m256i ab = _mm256_maddubs_epi16(_mm256_add_epi8(in, roll), _mm256_set1_epi32(0x01400140));
+    __m256i abcd = _mm256_shuffle_epi8(_mm256_madd_epi16(ab, _mm256_set1_epi32(0x00011000)),
+                                       _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                                                        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1));
+    abcd = _mm256_permutevar8x32_epi32(abcd, _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+    uchar block[32];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(block), abcd);
+    std::memcpy(data, block, 24);
+    return true;
+}
+
+__attribute__((target("sse4.1")))
+char *toHexSse41(char *text, const uchar *data, size_t size)
+{
+    const __m128i digits = _mm_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7',
+                                         '8', '9', 'a', 'b', 'c', 'd', 'e', 'f');
+    const __m128i mask = _mm_set1_epi8(0x0F);
+
+    for (; size >= 16; size -= 16, data += 16, text += 32) {
+        const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+        const __m128i hi = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(in, 4), mask));
+        const __m128i lo = _mm_shuffle_epi8(digits, _mm_and_si128(in, mask));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(text), _mm_unpacklo_epi8(hi, lo));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(text + 16), _mm_unpackhi_epi8(hi, lo));
+    }
+
+    return toHexScalar(text, data, size);
+}
+
+/**
+ * @brief fromHexDigits converts 16 digits of either case into their values
+ * @return false if any character is not a digit
+ */
+__attribute__((target("sse4.1")))
+inline bool fromHexDigits(__m128i &values, const char *text)
+{
+    const __m128i in = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text));
+    const __m128i decimal = _mm_sub_epi8(in, _mm_set1_epi8('0'));
+    const __m128i alpha = _mm_sub_epi8(_mm_or_si128(in, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+    const __m128i isDecimal = _mm_cmpeq_epi8(_mm_min_epu8(decimal, _mm_set1_epi8(9)), decimal);
+    const __m128i isAlpha = _mm_cmpeq_epi8(_mm_min_epu8(alpha, _mm_set1_epi8(5)), alpha);
+
+    if (_mm_movemask_epi8(_mm_or_si128(isDecimal, isAlpha)) != 0xFFFF)
+        return false;
+
+    values = _mm_blendv_epi8(_mm_add_epi8(alpha, _mm_set1_epi8(10)), decimal, isDecimal);
+    return true;
+}
+
+/**
+ * @brief fromHexSse41 decodes 32 digits into 16 bytes
+ * @return false if any character is not a digit
+ */
+__attribute__((target("sse4.1")))
+inline bool fromHexSse41(uchar *data, const char *text)
+{
+    __m128i lo, hi;
+
+    if (!fromHexDigits(lo, text) || !fromHexDigits(hi, text + 16))
+        return false;
+
+    const __m128i nibbles = _mm_set1_epi16(0x0110);
+    const __m128i bytes = _mm_packus_epi16(_mm_maddubs_epi16(lo, nibbles), _mm_maddubs_epi16(hi, nibbles));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(data), bytes);
+    return true;
+}
+
+Level detect()
+{
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2"))
+        return Avx2;
+    else if (__builtin_cpu_supports("sse4.1"))
+        return Sse41;
+    else
+        return Scalar;
+}
+#else
+Level detect()
+{
+    return Scalar;
+}
+#endif
+
+/**
+ * @brief level of instructions supported by the processor, detected once
+ */
+Level level()
+{
+    static const Level supported = detect();
+    return supported;
+}
+
+/**
+ * @brief fromBase64Blocks decodes whole blocks of digits as long as there are any
+ */
+inline void fromBase64Blocks(uchar *&data, const char *&text, const char *end)
+{
+#ifdef QRYPTO_ENCODING_X86
+    switch (level()) {
+    case Avx2:
+        for (; end - text >= 32 && fromBase64Avx2(data, text); text += 32)
+            data += 24;
+        /* FALLTHRU */
+    case Sse41:
+        for (; end - text >= 16 && fromBase64Sse41(data, text); text += 16)
+            data += 12;
+        /* FALLTHRU */
+    default:
+        break;
+    }
+#else
+    Q_UNUSED(data);
+    Q_UNUSED(text);
+    Q_UNUSED(end);
+#endif
+}
+
+inline void fromHexBlocks(uchar *&data, const char *&text, const char *end)
+{
+#ifdef QRYPTO_ENCODING_X86
+    if (level() != Scalar) {
+        for (; end - text >= 32 && fromHexSse41(data, text); text += 32)
+            data += 16;
+    }
+#else
+    Q_UNUSED(data);
+    Q_UNUSED(text);
+    Q_UNUSED(end);
+#endif
+}
+}
+
+size_t Encoding::base64Size(size_t size, size_t lineSize)
+{
+    return (size + 2) / 3 * 4 + (lineSize ? (size + lineSize - 1) / lineSize : 0);
+}
+
+char *Encoding::toBase64(char *text, const char *data, size_t size, size_t lineSize)
+{
+    const uchar *bytes = reinterpret_cast<const uchar*>(data);
+
+    for (size_t line = lineSize ? lineSize : size; size; bytes += line, size -= line) {
+        line = std::min(line, size);
+
+        if (lineSize)
+            *text++ = '\n';
+
+        switch (level()) {
+#ifdef QRYPTO_ENCODING_X86
+        case Avx2:
+            text = toBase64Avx2(text, bytes, line);
+            break;
+        case Sse41:
+            text = toBase64Sse41(text, bytes, line);
+            break;
+#endif
+        default:
+            text = toBase64Scalar(text, bytes, line);
+        }
+    }
+
+    return text;
+}
+
+QByteArray Encoding::toBase64(const char *data, int size, int lineSize)
+{
+    QByteArray text(int(base64Size(size, lineSize)), Qt::Uninitialized);
+    toBase64(text.data(), data, size, lineSize);
+    return text;
+}
+
+char *Encoding::fromBase64(char *data, const char *text, size_t size)
+{
+    const char *end = text + size;
+    uchar *bytes = reinterpret_cast<uchar*>(data);
+    uint bits = 0;
+    int digits = 0;
+
+    while (text != end) {
+        if (!digits)
+            fromBase64Blocks(bytes, text, end);
+
+        if (text == end)
+            break;
+
+        const uchar digit = Decoding.base64[uchar(*text++)];
+
+        if (digit < 64) {
+            bits = bits << 6 | digit;
+
+            if (++digits == 4) {
+                *bytes++ = uchar(bits >> 16);
+                *bytes++ = uchar(bits >> 8);
+                *bytes++ = uchar(bits);
+                digits = 0;
+            }
+        } else if (text[-1] == '=') {
+            for (; text != end && (*text == '=' || Decoding.base64[uchar(*text)] == Space); ++text);
+
+            if (text != end)
+                return 0;
+        } else if (digit != Space) {
+            return 0;
+        }
+    }
+
+    switch (digits) {
+    case 1:
+        return 0;
+    case 2:
+        *bytes++ = uchar(bits >> 4);
+        break;
+    case 3:
+        *bytes++ = uchar(bits >> 10);
+        *bytes++ = uchar(bits >> 2);
+        break;
+    }
+
+    return reinterpret_cast<char*>(bytes);
+}
+
+bool Encoding::fromBase64(QByteArray &data, const char *text, int size)
+{
+    const int offset = data.size();
+    data.resize(offset + size / 4 * 3 + 3);
+    const char *end = fromBase64(data.data() + offset, text, size);
+    data.resize(end ? int(end - data.constData()) : offset);
+    return end;
+}
+
+char *Encoding::toHex(char *text, const char *data, size_t size)
+{
+    const uchar *bytes = reinterpret_cast<const uchar*>(data);
+
+#ifdef QRYPTO_ENCODING_X86
+    if (level() != Scalar)
+        return toHexSse41(text, bytes, size);
+#endif
+
+    return toHexScalar(text, bytes, size);
+}
+
+QByteArray Encoding::toHex(const char *data, int size)
+{
+    QByteArray text(size * 2, Qt::Uninitialized);
+    toHex(text.data(), data, size);
+    return text;
+}
+
+char *Encoding::fromHex(char *data, const char *text, size_t size)
+{
+    const char *end = text + size;
+    uchar *bytes = reinterpret_cast<uchar*>(data);
+    uint bits = 0;
+    int digits = 0;
+
+    while (text != end) {
+        if (!digits)
+            fromHexBlocks(bytes, text, end);
+
+        if (text == end)
+            break;
+
+        const uchar digit = Decoding.hex[uchar(*text++)];
+
+        if (digit < 16) {
+            bits = bits << 4 | digit;
+
+            if (++digits == 2) {
+                *bytes++ = uchar(bits);
+                digits = 0;
+            }
+        } else if (digit != Space) {
+            return 0;
+        }
+    }
+
+    return digits ? 0 : reinterpret_cast<char*>(bytes);
+}
+
+bool Encoding::fromHex(QByteArray &data, const char *text, int size)
+{
+    const int offset = data.size();
+    data.resize(offset + size / 2);
+    const char *end = fromHex(data.data() + offset, text, size);
+    data.resize(end ? int(end - data.constData()) : offset);
+    return end;
+}
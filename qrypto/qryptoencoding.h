@@ -0,0 +1,89 @@
+/* Qrypto 2019
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**/
+#ifndef QRYPTO_ENCODING_H
+#define QRYPTO_ENCODING_H
+
+#include <QByteArray>
+
+#include <cstddef>
+
+namespace Qrypto
+{
+
+/**
+ * @brief The Encoding class converts between bytes and Base64 or Base16 text in place,
+ * with AVX2 or SSE4.1 when the processor supports them
+ * @note unlike QByteArray, decoding rejects any character but white space
+ */
+class Encoding
+{
+public:
+    /**
+     * @brief base64Size of text encoded by toBase64
+     * @param size of data in bytes
+     * @param lineSize in bytes of data per line, 0 for a single line
+     */
+    static size_t base64Size(size_t size, size_t lineSize = 0);
+
+    /**
+     * @brief toBase64 encodes data with padding, starting every line with a line feed
+     * @param text receives base64Size(size, lineSize) characters
+     * @param data
+     * @param size in bytes
+     * @param lineSize in bytes of data per line, a multiple of 3, or 0 for a single line
+     * @return end of text
+     */
+    static char *toBase64(char *text, const char *data, size_t size, size_t lineSize = 0);
+
+    static QByteArray toBase64(const char *data, int size, int lineSize = 0);
+
+    /**
+     * @brief fromBase64 decodes text skipping white space
+     * @param data receives at most size * 3 / 4 bytes
+     * @param text
+     * @param size in characters
+     * @return end of data or null on invalid text
+     */
+    static char *fromBase64(char *data, const char *text, size_t size);
+
+    /**
+     * @brief fromBase64 appends the decoded text to data
+     * @return false on invalid text, data is left as it was
+     */
+    static bool fromBase64(QByteArray &data, const char *text, int size);
+
+    /**
+     * @brief toHex encodes data in lower case
+     * @param text receives size * 2 characters
+     * @return end of text
+     */
+    static char *toHex(char *text, const char *data, size_t size);
+
+    static QByteArray toHex(const char *data, int size);
+
+    /**
+     * @brief fromHex decodes text of either case skipping white space
+     * @param data receives at most size / 2 bytes
+     * @return end of data or null on invalid text
+     */
+    static char *fromHex(char *data, const char *text, size_t size);
+
+    /**
+     * @brief fromHex appends the decoded text to data
+     * @return false on invalid text, data is left as it was
+     */
+    static bool fromHex(QByteArray &data, const char *text, int size);
+};
+
+}
+
+#endif // QRYPTO_ENCODING_H
@@ -18,11 +18,14 @@
 #include "qrypto.h"
 #include "sequre.h"
 
+#include <QVector>
+
 namespace Qrypto
 {
 
 /**
- * @brief The KeyMaker class conforms to PKCS #5 PBKDF2-HMAC
+ * @brief The KeyMaker class conforms to PKCS #5 PBKDF2-HMAC, or derives keys
+ * with the memory-hard functions Argon2id and scrypt
  * @ref https://tools.ietf.org/html/rfc2898#section-5.2
  */
 class KeyMaker
@@ -31,10 +34,13 @@ class KeyMaker
     friend struct Impl;
 
     QString m_algorithmName;
-    SequreData m_key;
+    QString m_functionName;
+    SequreKey m_key;
     QByteArray m_salt;
     uint m_iteration;
     uint m_iterationTime;
+    uint m_memoryCost;
+    uint m_parallelism;
 
 public:
     enum Algorithm {
@@ -56,16 +62,73 @@ public:
 
     static const QStringList AlgorithmNames;
 
+    enum Function {
+        Pbkdf2,
+        Argon2id,
+        Scrypt,
+        UnknownFunction
+    };
+
+    static const QStringList FunctionNames;
+
+    static const uint DefaultIterations = 100000; ///< of Pbkdf2
+
+    static const uint DefaultPasses = 3; ///< of Argon2id over the memory
+
+    /**
+     * @brief The Hmac class authenticates a message piece by piece,
+     * with HMAC of the Algorithm and key of a KeyMaker
+     * @note lets a cipher pass authenticate each chunk while it is in cache
+     */
+    class Hmac
+    {
+        struct Impl;
+        Impl *d;
+
+        Q_DISABLE_COPY(Hmac)
+
+    public:
+        Hmac();
+
+        ~Hmac();
+
+        /**
+         * @brief init starts a message, discarding any previous one
+         * @param keyMaker with derived key, copied here
+         * @return false without key or with an unknown Algorithm
+         */
+        bool init(const KeyMaker &keyMaker);
+
+        bool isValid() const;
+
+        /**
+         * @brief update appends a piece of the message
+         * @param data
+         * @param size in bytes
+         */
+        void update(const char *data, quint64 size);
+
+        /**
+         * @brief final ends the message, ready for the next one with the same key
+         * @param truncatedSize in bytes of digest code
+         * @return digest code or null QByteArray if not initialized
+         */
+        QByteArray final(uint truncatedSize = 0);
+    };
+
     /**
      * @brief KeyMaker default constructor
      * @param algorithm
-     * @param keyLength in bytes
+     * @param keyLength in bytes, up to SequreKey::Capacity
      */
     KeyMaker(Algorithm algorithm = Sha256, uint keyLength = 16) :
         m_algorithmName(AlgorithmNames.at(algorithm)),
+        m_functionName(FunctionNames.at(Pbkdf2)),
         m_key(keyLength, '\0'),
-        m_iteration(100000),
-        m_iterationTime(0)
+        m_iteration(DefaultIterations),
+        m_iterationTime(0),
+        m_memoryCost(65536),
+        m_parallelism(4)
     { }
 
     /**
@@ -76,11 +139,19 @@ public:
      * @return digest code or null QByteArray on error
      * @ref https://tools.ietf.org/html/rfc2898#section-7.1
      */
-    QByteArray authenticate(const char *messageData, uint messageSize, uint truncatedSize = 0) const;
+    QByteArray authenticate(const char *messageData, quint64 messageSize, uint truncatedSize = 0) const;
 
     QByteArray authenticate(const QByteArray &message, uint truncatedSize = 0) const
     { return authenticate(message.constData(), message.size(), truncatedSize); }
 
+    /**
+     * @brief authenticator streams a message into an Hmac
+     * @param code receives the digest code when the Sink is closed
+     * @param truncatedSize in bytes of digest code
+     * @return Sink owned by the caller or null on error
+     */
+    Sink *authenticator(QByteArray &code, uint truncatedSize = 0) const;
+
     /**
      * @brief deriveKey generates internal key
      * @param passwordData should not be null
@@ -93,8 +164,35 @@ public:
     Error deriveKey(const QByteArray &password, uint keyLength = 0)
     { return deriveKey(password.constData(), password.size(), keyLength); }
 
+    /**
+     * @brief The Derivation struct is one deriveKey call of a batch
+     */
+    struct Derivation
+    {
+        KeyMaker *keyMaker;
+        const char *passwordData;
+        uint passwordSize;
+        uint keyLength; ///< in bytes, will use existing key length if zero
+        Error error; ///< set by deriveKeys
+
+        Derivation(KeyMaker *keyMaker = 0, const char *passwordData = 0, uint passwordSize = 0, uint keyLength = 0) :
+            keyMaker(keyMaker),
+            passwordData(passwordData),
+            passwordSize(passwordSize),
+            keyLength(keyLength),
+            error(NoError)
+        { }
+    };
+
+    /**
+     * @brief deriveKeys does every deriveKey of the batch, running the iteration chains
+     * of SHA-1 and SHA-2 key makers side by side in SIMD lanes
+     * @note key makers with an iterationTime, another Algorithm or a memory-hard Function derive one by one
+     */
+    static void deriveKeys(QVector<Derivation> &batch);
+
     const uchar *keyData() const
-    { return m_key->data(); }
+    { return m_key.data(); }
 
     Algorithm algorithm() const
     {
@@ -124,8 +222,67 @@ public:
             m_algorithmName.clear();
     }
 
+    Function function() const
+    {
+        for (int i = FunctionNames.size(); i-- > 0; ) {
+            if (FunctionNames.at(i).compare(m_functionName, Qt::CaseInsensitive) == 0)
+                return Function(i);
+        }
+
+        return UnknownFunction;
+    }
+
+    /**
+     * @brief setFunction of key derivation, Pbkdf2 by default
+     * @note Argon2id makes iterationCount passes over the memory, scrypt ignores it,
+     * so a change of function resets iterationCount to DefaultIterations or DefaultPasses
+     */
+    void setFunction(Function function)
+    {
+        if (function != this->function() && function == Pbkdf2)
+            m_iteration = DefaultIterations;
+        else if (function != this->function())
+            m_iteration = DefaultPasses;
+
+        m_functionName = FunctionNames.at(function);
+    }
+
+    QString functionName() const
+    { return m_functionName; }
+
     /**
-     * @brief iterationCount is 100000 by default
+     * @brief setFunctionName
+     * @param functionName will be matched Caseinsensitively
+     */
+    void setFunctionName(const QString &functionName)
+    {
+        if (FunctionNames.contains(functionName, Qt::CaseInsensitive))
+            m_functionName = functionName;
+        else
+            m_functionName.clear();
+    }
+
+    /**
+     * @brief memoryCost of Argon2id and scrypt is 65536 KiB by default, shared by the lanes
+     * @note scrypt rounds the memory of each lane down to a power of two
+     */
+    uint memoryCost() const
+    { return m_memoryCost; }
+
+    void setMemoryCost(uint kibibytes)
+    { m_memoryCost = kibibytes; }
+
+    /**
+     * @brief parallelism of Argon2id and scrypt is 4 lanes by default, filled on threads of the pool
+     */
+    uint parallelism() const
+    { return m_parallelism; }
+
+    void setParallelism(uint lanes)
+    { m_parallelism = lanes; }
+
+    /**
+     * @brief iterationCount is DefaultIterations of Pbkdf2 by default, or DefaultPasses of Argon2id
      * @return
      */
     uint iterationCount() const
@@ -136,6 +293,7 @@ public:
 
     /**
      * @brief iterationTime is 0 milliseconds by default (disabled)
+     * @note only PBKDF2 adapts its iterationCount to the time
      * @return
      */
     uint iterationTime() const
@@ -144,6 +302,12 @@ public:
     void setIterationTime(uint milliseconds)
     { m_iterationTime = milliseconds; }
 
+    /**
+     * @brief digestSize of the Algorithm
+     * @return in bytes, 0 with an unknown Algorithm
+     */
+    uint digestSize() const;
+
     uint keyBitSize() const
     { return keyLength() * 8; }
 
@@ -151,8 +315,12 @@ public:
     { setKeyLength(bits / 8); }
 
     uint keyLength() const
-    { return m_key->size(); }
+    { return m_key.size(); }
 
+    /**
+     * @brief setKeyLength
+     * @param keyLength in bytes, clamped to SequreKey::Capacity
+     */
     void setKeyLength(uint keyLength)
     { m_key.resize(keyLength); }
 
@@ -0,0 +1,593 @@
+#include "qryptomemoryhard.h"
+
+#include "qryptopbkdf2.h"
+#include "sequrearena.h"
+
+#include <QVector>
+#include <QtConcurrentMap>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+using namespace Qrypto;
+
+namespace
+{
+inline quint64 rotr64(quint64 x, int n)
+{ return (x >> n) | (x << (64 - n)); }
+
+inline quint32 rotl32(quint32 x, int n)
+{ return (x << n) | (x >> (32 - n)); }
+
+inline quint32 load32(const uchar *bytes)
+{ return quint32(bytes[0]) | quint32(bytes[1]) << 8 | quint32(bytes[2]) << 16 | quint32(bytes[3]) << 24; }
+
+inline quint64 load64(const uchar *bytes)
+{ return quint64(load32(bytes)) | quint64(load32(bytes + 4)) << 32; }
+
+inline void store32(uchar *bytes, quint32 word)
+{
+    for (int byte = 0; byte < 4; ++byte, word >>= 8)
+        bytes[byte] = uchar(word);
+}
+
+inline void store64(uchar *bytes, quint64 word)
+{
+    store32(bytes, quint32(word));
+    store32(bytes + 4, quint32(word >> 32));
+}
+
+/**
+ * @brief The Blake2b struct hashes without key with BLAKE2b
+ * @ref https://tools.ietf.org/html/rfc7693
+ */
+struct Blake2b
+{
+    static const quint64 Iv[8];
+    static const uchar Sigma[12][16];
+
+    quint64 h[8];
+    quint64 counter;
+    uchar block[128];
+    size_t filled;
+    size_t digestSize;
+
+    /**
+     * @param digestSize in bytes, from 1 to 64
+     */
+    explicit Blake2b(size_t digestSize) :
+        counter(0),
+        filled(0),
+        digestSize(digestSize)
+    {
+        std::copy(Iv, Iv + 8, h);
+        h[0] ^= 0x01010000 ^ digestSize;
+    }
+
+    static void mix(quint64 *v, int a, int b, int c, int d, quint64 x, quint64 y)
+    {
+        v[a] += v[b] + x;
+        v[d] = rotr64(v[d] ^ v[a], 32);
+        v[c] += v[d];
+        v[b] = rotr64(v[b] ^ v[c], 24);
+        v[a] += v[b] + y;
+        v[d] = rotr64(v[d] ^ v[a], 16);
+        v[c] += v[d];
+        v[b] = rotr64(v[b] ^ v[c], 63);
+    }
+
+    void compress(bool last)
+    {
+        quint64 v[16];
+        quint64 m[16];
+
+        for (int word = 0; word < 16; ++word)
+            m[word] = load64(block + word * 8);
+
+        for (int word = 0; word < 8; ++word) {
+            v[word] = h[word];
+            v[word + 8] = Iv[word];
+        }
+
+        v[12] ^= counter;
+
+        if (last)
+            v[14] = ~v[14];
+
+        for (int round = 0; round < 12; ++round) {
+            const uchar *s = Sigma[round];
+            mix(v, 0, 4,  8, 12, m[s[ 0]], m[s[ 1]]);
+            mix(v, 1, 5,  9, 13, m[s[ 2]], m[s[ 3]]);
+            mix(v, 2, 6, 10, 14, m[s[ 4]], m[s[ 5]]);
+            mix(v, 3, 7, 11, 15, m[s[ 6]], m[s[ 7]]);
+            mix(v, 0, 5, 10, 15, m[s[ 8]], m[s[ 9]]);
+            mix(v, 1, 6, 11, 12, m[s[10]], m[s[11]]);
+            mix(v, 2, 7,  8, 13, m[s[12]], m[s[13]]);
+            mix(v, 3, 4,  9, 14, m[s[14]], m[s[15]]);
+        }
+
+        for (int word = 0; word < 8; ++word)
+            h[word] ^= v[word] ^ v[word + 8];
+    }
+
+    void update(const void *data, size_t size)
+    {
+        for (const uchar *bytes = static_cast<const uchar*>(data); size > 0; ) {
+            if (filled == sizeof block) {
+                counter += sizeof block;
+                compress(false);
+                filled = 0;
+            }
+
+            const size_t count = qMin(size, sizeof block - filled);
+            std::memcpy(block + filled, bytes, count);
+            filled += count;
+            bytes += count;
+            size -= count;
+        }
+    }
+
+    /**
+     * @brief update with a little-endian 32 bit word
+     */
+    void update(quint32 word)
+    {
+        uchar bytes[4];
+        store32(bytes, word);
+        update(bytes, sizeof bytes);
+    }
+
+    void final(uchar *digest)
+    {
+        uchar bytes[64];
+        counter += filled;
+        std::memset(block + filled, 0, sizeof block - filled);
+        compress(true);
+
+        for (int word = 0; word < 8; ++word)
+            store64(bytes + word * 8, h[word]);
+
+        std::memcpy(digest, bytes, digestSize);
+    }
+};
+
+const quint64 Blake2b::Iv[] = {
+    0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+    0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+};
+
+const uchar Blake2b::Sigma[][16] = {
+    {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+    { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+    { 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
+    {  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
+    {  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
+    {  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
+    { 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
+    { 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
+    {  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
+    { 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0 },
+    {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+    { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 }
+};
+
+/**
+ * @brief expand is the variable-length hash function H' of Argon2
+ */
+void expand(uchar *digest, size_t digestSize, const uchar *data, size_t size)
+{
+    uchar v[64];
+    Blake2b first(qMin<size_t>(digestSize, 64));
+    first.update(quint32(digestSize));
+    first.update(data, size);
+
+    if (digestSize <= 64) {
+        first.final(digest);
+        return;
+    }
+
+    first.final(v);
+
+    for (; digestSize > 64; digest += 32, digestSize -= 32) {
+        std::memcpy(digest, v, 32);
+
+        if (digestSize - 32 > 64) {
+            Blake2b next(64);
+            next.update(v, sizeof v);
+            next.final(v);
+        }
+    }
+
+    Blake2b last(digestSize);
+    last.update(v, sizeof v);
+    last.final(digest);
+}
+
+/**
+ * @brief The Argon2 struct fills the segments of a slice of the memory, one lane at a time
+ */
+struct Argon2
+{
+    typedef void result_type;
+
+    static const uint SyncPoints = 4;
+    static const uint AddressesInBlock = 128;
+
+    struct Block
+    {
+        quint64 v[128];
+    };
+
+    Block *memory;
+    uint passes;
+    uint lanes;
+    uint memoryBlocks;
+    uint laneLength;
+    uint segmentLength;
+    uint pass;
+    uint slice;
+
+    static inline quint64 blaMka(quint64 x, quint64 y)
+    { return x + y + 2 * (x & 0xFFFFFFFF) * (y & 0xFFFFFFFF); }
+
+    static inline void mix(quint64 &a, quint64 &b, quint64 &c, quint64 &d)
+    {
+        a = blaMka(a, b);
+        d = rotr64(d ^ a, 32);
+        c = blaMka(c, d);
+        b = rotr64(b ^ c, 24);
+        a = blaMka(a, b);
+        d = rotr64(d ^ a, 16);
+        c = blaMka(c, d);
+        b = rotr64(b ^ c, 63);
+    }
+
+    /**
+     * @brief round permutes 16 words of r, the first at offset, pairs of them stride apart
+     */
+    static inline void round(quint64 *r, int offset, int stride)
+    {
+        quint64 v[16];
+
+        for (int word = 0; word < 16; word += 2) {
+            v[word] = r[offset + word / 2 * stride];
+            v[word + 1] = r[offset + word / 2 * stride + 1];
+        }
+
+        mix(v[0], v[4], v[8], v[12]);
+        mix(v[1], v[5], v[9], v[13]);
+        mix(v[2], v[6], v[10], v[14]);
+        mix(v[3], v[7], v[11], v[15]);
+        mix(v[0], v[5], v[10], v[15]);
+        mix(v[1], v[6], v[11], v[12]);
+        mix(v[2], v[7], v[8], v[13]);
+        mix(v[3], v[4], v[9], v[14]);
+
+        for (int word = 0; word < 16; word += 2) {
+            r[offset + word / 2 * stride] = v[word];
+            r[offset + word / 2 * stride + 1] = v[word + 1];
+        }
+    }
+
+    /**
+     * @brief fill is the compression function G, xoring into next after the first pass
+     */
+    static void fill(const Block &previous, const Block &reference, Block &next, bool xorNext)
+    {
+        quint64 r[128];
+        quint64 t[128];
+
+        for (int word = 0; word < 128; ++word) {
+            r[word] = previous.v[word] ^ reference.v[word];
+            t[word] = xorNext ? r[word] ^ next.v[word] : r[word];
+        }
+
+        for (int row = 0; row < 8; ++row)
+            round(r, row * 16, 2);
+
+        for (int column = 0; column < 8; ++column)
+            round(r, column * 2, 16);
+
+        for (int word = 0; word < 128; ++word)
+            next.v[word] = t[word] ^ r[word];
+    }
+
+    static void nextAddresses(Block &addresses, Block &input)
+    {
+        Block zero;
+        std::memset(&zero, 0, sizeof zero);
+        ++input.v[6];
+        fill(zero, input, addresses, false);
+        fill(zero, addresses, addresses, false);
+    }
+
+    /**
+     * @brief referenceIndex maps J1 to a column of the reference lane
+     */
+    uint referenceIndex(uint index, quint32 j1, bool sameLane) const
+    {
+        quint32 area;
+
+        if (pass == 0 && slice == 0)
+            area = index - 1;
+        else if (pass == 0 && sameLane)
+            area = slice * segmentLength + index - 1;
+        else if (pass == 0)
+            area = slice * segmentLength - (index == 0);
+        else if (sameLane)
+            area = laneLength - segmentLength + index - 1;
+        else
+            area = laneLength - segmentLength - (index == 0);
+
+        quint64 relative = quint64(j1) * j1 >> 32;
+        relative = area - 1 - (quint64(area) * relative >> 32);
+        const quint32 start = pass != 0 && slice != SyncPoints - 1 ? (slice + 1) * segmentLength : 0;
+        return uint((start + relative) % laneLength);
+    }
+
+    void operator()(const uint &lane) const
+    {
+        const bool independent = pass == 0 && slice < SyncPoints / 2; // Argon2i addressing
+        Block input;
+        Block addresses;
+        uint index = 0;
+
+        if (independent) {
+            std::memset(&input, 0, sizeof input);
+            input.v[0] = pass;
+            input.v[1] = lane;
+            input.v[2] = slice;
+            input.v[3] = memoryBlocks;
+            input.v[4] = passes;
+            input.v[5] = 2; // Argon2id
+        }
+
+        if (pass == 0 && slice == 0) {
+            index = 2; // the first two blocks come from the seed
+
+            if (independent)
+                nextAddresses(addresses, input);
+        }
+
+        uint current = lane * laneLength + slice * segmentLength + index;
+        uint previous = current % laneLength ? current - 1 : current + laneLength - 1;
+
+        for (; index < segmentLength; ++index, ++current, ++previous) {
+            if (current % laneLength == 1)
+                previous = current - 1;
+
+            quint64 random;
+
+            if (independent && index % AddressesInBlock == 0)
+                nextAddresses(addresses, input);
+
+            if (independent)
+                random = addresses.v[index % AddressesInBlock];
+            else
+                random = memory[previous].v[0];
+
+            const uint referenceLane = pass == 0 && slice == 0 ? lane : uint((random >> 32) % lanes);
+            const uint column = referenceIndex(index, quint32(random), referenceLane == lane);
+            fill(memory[previous], memory[referenceLane * laneLength + column], memory[current], pass > 0);
+        }
+    }
+};
+
+/**
+ * @brief The Scrypt struct mixes the blocks of the lanes of scrypt with ROMix
+ */
+struct Scrypt
+{
+    typedef void result_type;
+
+    uchar *blocks;
+    quint32 *memory;
+    quint64 cost;
+    uint blockSize;
+
+    static inline void quarter(quint32 *x, int a, int b, int c, int d)
+    {
+        x[b] ^= rotl32(x[a] + x[d], 7);
+        x[c] ^= rotl32(x[b] + x[a], 9);
+        x[d] ^= rotl32(x[c] + x[b], 13);
+        x[a] ^= rotl32(x[d] + x[c], 18);
+    }
+
+    static void salsa20(quint32 *b)
+    {
+        quint32 x[16];
+        std::copy(b, b + 16, x);
+
+        for (int round = 0; round < 8; round += 2) {
+            quarter(x, 0, 4, 8, 12);
+            quarter(x, 5, 9, 13, 1);
+            quarter(x, 10, 14, 2, 6);
+            quarter(x, 15, 3, 7, 11);
+            quarter(x, 0, 1, 2, 3);
+            quarter(x, 5, 6, 7, 4);
+            quarter(x, 10, 11, 8, 9);
+            quarter(x, 15, 12, 13, 14);
+        }
+
+        for (int word = 0; word < 16; ++word)
+            b[word] += x[word];
+    }
+
+    void blockMix(const quint32 *in, quint32 *out) const
+    {
+        quint32 x[16];
+        std::copy(in + (2 * blockSize - 1) * 16, in + 2 * blockSize * 16, x);
+
+        for (uint block = 0; block < 2 * blockSize; ++block) {
+            for (int word = 0; word < 16; ++word)
+                x[word] ^= in[block * 16 + word];
+
+            salsa20(x);
+            std::copy(x, x + 16, out + (block / 2 + block % 2 * blockSize) * 16);
+        }
+    }
+
+    void operator()(const uint &lane) const
+    {
+        const size_t words = 32 * size_t(blockSize);
+        uchar *bytes = blocks + lane * words * 4;
+        quint32 *v = memory + lane * (cost + 2) * words;
+        quint32 *x = v + cost * words;
+        quint32 *y = x + words;
+
+        for (size_t word = 0; word < words; ++word)
+            x[word] = load32(bytes + word * 4);
+
+        for (quint64 i = 0; i < cost; ++i) {
+            std::copy(x, x + words, v + i * words);
+            blockMix(x, y);
+            std::swap(x, y);
+        }
+
+        for (quint64 i = 0; i < cost; ++i) {
+            const quint32 *last = x + words - 16;
+            const quint32 *vj = v + ((quint64(last[1]) << 32 | last[0]) & (cost - 1)) * words;
+
+            for (size_t word = 0; word < words; ++word)
+                x[word] ^= vj[word];
+
+            blockMix(x, y);
+            std::swap(x, y);
+        }
+
+        for (size_t word = 0; word < words; ++word)
+            store32(bytes + word * 4, x[word]);
+    }
+};
+
+QVector<uint> laneIndexes(uint lanes)
+{
+    QVector<uint> indexes(int(lanes), 0);
+
+    for (uint lane = 0; lane < lanes; ++lane)
+        indexes[int(lane)] = lane;
+
+    return indexes;
+}
+}
+
+bool MemoryHard::argon2id(uchar *derived, size_t derivedSize,
+                          const char *password, size_t passwordSize,
+                          const char *salt, size_t saltSize,
+                          uint passes, uint memoryCost, uint lanes,
+                          const char *secret, size_t secretSize,
+                          const char *data, size_t dataSize)
+{
+    if (derivedSize < 4 || derivedSize > 0xFFFFFFFF || !passes || !lanes || lanes > 0xFFFFFF ||
+            memoryCost / 8 < lanes)
+        return false;
+
+    Argon2 argon2;
+    const size_t size = size_t(memoryCost / (Argon2::SyncPoints * lanes) * Argon2::SyncPoints * lanes) *
+            sizeof(Argon2::Block);
+    QVector<uint> indexes(laneIndexes(lanes));
+    uchar seed[72];
+    uchar bytes[sizeof(Argon2::Block)];
+    Blake2b hash(64);
+    hash.update(quint32(lanes));
+    hash.update(quint32(derivedSize));
+    hash.update(quint32(memoryCost));
+    hash.update(quint32(passes));
+    hash.update(quint32(0x13));
+    hash.update(quint32(2));
+    hash.update(quint32(passwordSize));
+    hash.update(password, passwordSize);
+    hash.update(quint32(saltSize));
+    hash.update(salt, saltSize);
+    hash.update(quint32(secretSize));
+    hash.update(secret, secretSize);
+    hash.update(quint32(dataSize));
+    hash.update(data, dataSize);
+    hash.final(seed);
+
+    argon2.memory = static_cast<Argon2::Block*>(SequreArena::instance().allocate(size));
+    argon2.passes = passes;
+    argon2.lanes = lanes;
+    argon2.memoryBlocks = uint(size / sizeof(Argon2::Block));
+    argon2.laneLength = argon2.memoryBlocks / lanes;
+    argon2.segmentLength = argon2.laneLength / Argon2::SyncPoints;
+
+    for (uint lane = 0; lane < lanes; ++lane) {
+        for (uint column = 0; column < 2; ++column) {
+            Argon2::Block &block = argon2.memory[lane * argon2.laneLength + column];
+            store32(seed + 64, column);
+            store32(seed + 68, lane);
+            expand(bytes, sizeof bytes, seed, sizeof seed);
+
+            for (int word = 0; word < 128; ++word)
+                block.v[word] = load64(bytes + word * 8);
+        }
+    }
+
+    for (argon2.pass = 0; argon2.pass < passes; ++argon2.pass) {
+        for (argon2.slice = 0; argon2.slice < Argon2::SyncPoints; ++argon2.slice)
+            QtConcurrent::blockingMap(indexes, argon2); // lanes meet at the end of each slice
+    }
+
+    Argon2::Block final = argon2.memory[argon2.laneLength - 1];
+
+    for (uint lane = 1; lane < lanes; ++lane) {
+        for (int word = 0; word < 128; ++word)
+            final.v[word] ^= argon2.memory[lane * argon2.laneLength + argon2.laneLength - 1].v[word];
+    }
+
+    for (int word = 0; word < 128; ++word)
+        store64(bytes + word * 8, final.v[word]);
+
+    expand(derived, derivedSize, bytes, sizeof bytes);
+    SequreArena::instance().deallocate(argon2.memory, size);
+    std::memset(&final, 0, sizeof final);
+    std::memset(bytes, 0, sizeof bytes);
+    std::memset(seed, 0, sizeof seed);
+    return true;
+}
+
+bool MemoryHard::scrypt(uchar *derived, size_t derivedSize,
+                        const char *password, size_t passwordSize,
+                        const char *salt, size_t saltSize,
+                        quint64 cost, uint blockSize, uint parallelism)
+{
+    const quint64 laneWords = 32 * quint64(blockSize);
+
+    if (cost < 2 || cost & (cost - 1) || !blockSize || !parallelism || blockSize > 0xFFFFFF ||
+            cost + 2 > std::numeric_limits<size_t>::max() / 4 / laneWords / parallelism)
+        return false;
+
+    Scrypt scrypt;
+    const size_t blocksSize = size_t(laneWords * 4 * parallelism);
+    const size_t memorySize = size_t((cost + 2) * laneWords * 4 * parallelism);
+    QVector<uint> indexes(laneIndexes(parallelism));
+    MultiPbkdf2::Job job = {
+        MultiPbkdf2::Sha256, password, passwordSize, salt, saltSize, 1, 0, blocksSize
+    };
+
+    scrypt.blocks = static_cast<uchar*>(SequreArena::instance().allocate(blocksSize));
+
+    try {
+        scrypt.memory = static_cast<quint32*>(SequreArena::instance().allocate(memorySize));
+    } catch (const std::bad_alloc &) {
+        SequreArena::instance().deallocate(scrypt.blocks, blocksSize);
+        throw;
+    }
+
+    scrypt.cost = cost;
+    scrypt.blockSize = blockSize;
+    job.derived = scrypt.blocks;
+    MultiPbkdf2::derive(&job, 1);
+    QtConcurrent::blockingMap(indexes, scrypt);
+    SequreArena::instance().deallocate(scrypt.memory, memorySize);
+
+    job.salt = reinterpret_cast<const char*>(scrypt.blocks);
+    job.saltSize = blocksSize;
+    job.derived = derived;
+    job.derivedSize = derivedSize;
+    MultiPbkdf2::derive(&job, 1);
+    SequreArena::instance().deallocate(scrypt.blocks, blocksSize);
+    return true;
+}
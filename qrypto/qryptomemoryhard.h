@@ -0,0 +1,68 @@
+/* Qrypto 2019
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**/
+#ifndef QRYPTO_MEMORYHARD_H
+#define QRYPTO_MEMORYHARD_H
+
+#include <QtGlobal>
+
+#include <cstddef>
+#include <new>
+
+namespace Qrypto
+{
+
+/**
+ * @brief The MemoryHard class derives keys with the memory-hard functions Argon2id and scrypt,
+ * filling their independent lanes on threads of the pool
+ * @note the memory is allocated in the SequreArena, so it is locked and wiped
+ */
+class MemoryHard
+{
+public:
+    /**
+     * @brief argon2id derives a key with Argon2id version 1.3
+     * @param derived receives derivedSize bytes, at least 4
+     * @param passes over the memory, at least 1
+     * @param memoryCost in KiB, at least 8 per lane
+     * @param lanes filled in parallel
+     * @param secret optional key
+     * @param data optional associated data
+     * @return false on invalid parameters
+     * @throw std::bad_alloc when the memory cannot be allocated
+     * @ref https://tools.ietf.org/html/rfc9106
+     */
+    static bool argon2id(uchar *derived, size_t derivedSize,
+                         const char *password, size_t passwordSize,
+                         const char *salt, size_t saltSize,
+                         uint passes, uint memoryCost, uint lanes,
+                         const char *secret = 0, size_t secretSize = 0,
+                         const char *data = 0, size_t dataSize = 0);
+
+    /**
+     * @brief scrypt derives a key with scrypt
+     * @param derived receives derivedSize bytes
+     * @param cost N, a power of two from 2, uses cost * blockSize * 128 bytes per lane
+     * @param blockSize r
+     * @param parallelism p, lanes filled in parallel
+     * @return false on invalid parameters
+     * @throw std::bad_alloc when the memory cannot be allocated
+     * @ref https://tools.ietf.org/html/rfc7914
+     */
+    static bool scrypt(uchar *derived, size_t derivedSize,
+                       const char *password, size_t passwordSize,
+                       const char *salt, size_t saltSize,
+                       quint64 cost, uint blockSize, uint parallelism);
+};
+
+}
+
+#endif // QRYPTO_MEMORYHARD_H
@@ -0,0 +1,680 @@
+#include "qryptopbkdf2.h"
+
+#include <QThread>
+#include <QVector>
+#include <QtConcurrentMap>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#if defined(Q_CC_GNU) || defined(Q_CC_CLANG)
+#define QRYPTO_PBKDF2_VECTOR
+#define QRYPTO_INLINE inline __attribute__((always_inline))
+#else
+#define QRYPTO_INLINE inline
+#endif
+
+#if defined(QRYPTO_PBKDF2_VECTOR) && defined(Q_PROCESSOR_X86)
+#define QRYPTO_PBKDF2_X86
+#endif
+
+using namespace Qrypto;
+
+namespace
+{
+typedef MultiPbkdf2::Level Level;
+
+/// rotates words of W, or each lane of a vector, without passing vectors by value
+#define QRYPTO_ROTR(W, x, n) (((x) >> (n)) | ((x) << (int(sizeof(W)) * 8 - (n))))
+
+template <typename W>
+inline W load(const uchar *bytes)
+{
+    W word = 0;
+
+    for (size_t byte = 0; byte < sizeof(W); ++byte)
+        word = (word << 8) | bytes[byte];
+
+    return word;
+}
+
+template <typename W>
+inline void store(uchar *bytes, W word)
+{
+    for (size_t byte = sizeof(W); byte-- > 0; word >>= 8)
+        bytes[byte] = uchar(word);
+}
+
+struct Sha1
+{
+    typedef quint32 Word;
+    enum { StateWords = 5, DigestWords = 5, BlockBytes = 64, LengthBytes = 8 };
+    static const Word Initial[StateWords];
+
+    template <typename V>
+    static QRYPTO_INLINE void compress(V *state, const V *block)
+    {
+        V w[16];
+        V a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+
+        for (int t = 0; t < 80; ++t) {
+            if (t < 16)
+                w[t] = block[t];
+            else
+                w[t & 15] = QRYPTO_ROTR(Word, w[(t - 3) & 15] ^ w[(t - 8) & 15] ^ w[(t - 14) & 15] ^ w[t & 15], 31);
+
+            V f;
+            Word k;
+
+            if (t < 20) {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999;
+            } else if (t < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            } else if (t < 60) {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDC;
+            } else {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+
+            const V temp = QRYPTO_ROTR(Word, a, 27) + f + e + k + w[t & 15];
+            e = d;
+            d = c;
+            c = QRYPTO_ROTR(Word, b, 2);
+            b = a;
+            a = temp;
+        }
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+    }
+};
+
+struct Sha256
+{
+    typedef quint32 Word;
+    enum { StateWords = 8, DigestWords = 8, BlockBytes = 64, LengthBytes = 8 };
+    static const Word Initial[StateWords];
+    static const Word K[64];
+
+    template <typename V>
+    static QRYPTO_INLINE void compress(V *state, const V *block)
+    {
+        V w[16];
+        V a = state[0], b = state[1], c = state[2], d = state[3];
+        V e = state[4], f = state[5], g = state[6], h = state[7];
+
+        for (int t = 0; t < 64; ++t) {
+            if (t < 16) {
+                w[t] = block[t];
+            } else {
+                const V w15 = w[(t - 15) & 15];
+                const V w2 = w[(t - 2) & 15];
+                w[t & 15] += (QRYPTO_ROTR(Word, w15, 7) ^ QRYPTO_ROTR(Word, w15, 18) ^ (w15 >> 3)) + w[(t - 7) & 15] +
+                        (QRYPTO_ROTR(Word, w2, 17) ^ QRYPTO_ROTR(Word, w2, 19) ^ (w2 >> 10));
+            }
+
+            const V t1 = h + (QRYPTO_ROTR(Word, e, 6) ^ QRYPTO_ROTR(Word, e, 11) ^ QRYPTO_ROTR(Word, e, 25)) + ((e & f) ^ (~e & g)) +
+                    K[t] + w[t & 15];
+            const V t2 = (QRYPTO_ROTR(Word, a, 2) ^ QRYPTO_ROTR(Word, a, 13) ^ QRYPTO_ROTR(Word, a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+};
+
+struct Sha224 : Sha256
+{
+    enum { DigestWords = 7 };
+    static const Word Initial[StateWords];
+};
+
+struct Sha512
+{
+    typedef quint64 Word;
+    enum { StateWords = 8, DigestWords = 8, BlockBytes = 128, LengthBytes = 16 };
+    static const Word Initial[StateWords];
+    static const Word K[80];
+
+    template <typename V>
+    static QRYPTO_INLINE void compress(V *state, const V *block)
+    {
+        V w[16];
+        V a = state[0], b = state[1], c = state[2], d = state[3];
+        V e = state[4], f = state[5], g = state[6], h = state[7];
+
+        for (int t = 0; t < 80; ++t) {
+            if (t < 16) {
+                w[t] = block[t];
+            } else {
+                const V w15 = w[(t - 15) & 15];
+                const V w2 = w[(t - 2) & 15];
+                w[t & 15] += (QRYPTO_ROTR(Word, w15, 1) ^ QRYPTO_ROTR(Word, w15, 8) ^ (w15 >> 7)) + w[(t - 7) & 15] +
+                        (QRYPTO_ROTR(Word, w2, 19) ^ QRYPTO_ROTR(Word, w2, 61) ^ (w2 >> 6));
+            }
+
+            const V t1 = h + (QRYPTO_ROTR(Word, e, 14) ^ QRYPTO_ROTR(Word, e, 18) ^ QRYPTO_ROTR(Word, e, 41)) + ((e & f) ^ (~e & g)) +
+                    K[t] + w[t & 15];
+            const V t2 = (QRYPTO_ROTR(Word, a, 28) ^ QRYPTO_ROTR(Word, a, 34) ^ QRYPTO_ROTR(Word, a, 39)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+};
+
+struct Sha384 : Sha512
+{
+    enum { DigestWords = 6 };
+    static const Word Initial[StateWords];
+};
+
+const Sha1::Word Sha1::Initial[] = {
+    0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0
+};
+
+const Sha256::Word Sha256::Initial[] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+
+const Sha256::Word Sha224::Initial[] = {
+    0xc1059ed8, 0x367cd507, 0x3070dd17, 0xf70e5939, 0xffc00b31, 0x68581511, 0x64f98fa7, 0xbefa4fa4
+};
+
+const Sha256::Word Sha256::K[] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+const Sha512::Word Sha512::Initial[] = {
+    0x6a09e667f3bcc908ULL, 0xbb67ae8584caa73bULL, 0x3c6ef372fe94f82bULL, 0xa54ff53a5f1d36f1ULL,
+    0x510e527fade682d1ULL, 0x9b05688c2b3e6c1fULL, 0x1f83d9abfb41bd6bULL, 0x5be0cd19137e2179ULL
+};
+
+const Sha512::Word Sha384::Initial[] = {
+    0xcbbb9d5dc1059ed8ULL, 0x629a292a367cd507ULL, 0x9159015a3070dd17ULL, 0x152fecd8f70e5939ULL,
+    0x67332667ffc00b31ULL, 0x8eb44a8768581511ULL, 0xdb0c2e0d64f98fa7ULL, 0x47b5481dbefa4fa4ULL
+};
+
+const Sha512::Word Sha512::K[] = {
+    0x428a2f98d728ae22ULL, 0x7137449123ef65cdULL, 0xb5c0fbcfec4d3b2fULL, 0xe9b5dba58189dbbcULL,
+    0x3956c25bf348b538ULL, 0x59f111f1b605d019ULL, 0x923f82a4af194f9bULL, 0xab1c5ed5da6d8118ULL,
+    0xd807aa98a3030242ULL, 0x12835b0145706fbeULL, 0x243185be4ee4b28cULL, 0x550c7dc3d5ffb4e2ULL,
+    0x72be5d74f27b896fULL, 0x80deb1fe3b1696b1ULL, 0x9bdc06a725c71235ULL, 0xc19bf174cf692694ULL,
+    0xe49b69c19ef14ad2ULL, 0xefbe4786384f25e3ULL, 0x0fc19dc68b8cd5b5ULL, 0x240ca1cc77ac9c65ULL,
+    0x2de92c6f592b0275ULL, 0x4a7484aa6ea6e483ULL, 0x5cb0a9dcbd41fbd4ULL, 0x76f988da831153b5ULL,
+    0x983e5152ee66dfabULL, 0xa831c66d2db43210ULL, 0xb00327c898fb213fULL, 0xbf597fc7beef0ee4ULL,
+    0xc6e00bf33da88fc2ULL, 0xd5a79147930aa725ULL, 0x06ca6351e003826fULL, 0x142929670a0e6e70ULL,
+    0x27b70a8546d22ffcULL, 0x2e1b21385c26c926ULL, 0x4d2c6dfc5ac42aedULL, 0x53380d139d95b3dfULL,
+    0x650a73548baf63deULL, 0x766a0abb3c77b2a8ULL, 0x81c2c92e47edaee6ULL, 0x92722c851482353bULL,
+    0xa2bfe8a14cf10364ULL, 0xa81a664bbc423001ULL, 0xc24b8b70d0f89791ULL, 0xc76c51a30654be30ULL,
+    0xd192e819d6ef5218ULL, 0xd69906245565a910ULL, 0xf40e35855771202aULL, 0x106aa07032bbd1b8ULL,
+    0x19a4c116b8d2d0c8ULL, 0x1e376c085141ab53ULL, 0x2748774cdf8eeb99ULL, 0x34b0bcb5e19b48a8ULL,
+    0x391c0cb3c5c95a63ULL, 0x4ed8aa4ae3418acbULL, 0x5b9cca4f7763e373ULL, 0x682e6ff3d6b2b8a3ULL,
+    0x748f82ee5defb2fcULL, 0x78a5636f43172f60ULL, 0x84c87814a1f0ab72ULL, 0x8cc702081a6439ecULL,
+    0x90befffa23631e28ULL, 0xa4506cebde82bde9ULL, 0xbef9a3f7b2c67915ULL, 0xc67178f2e372532bULL,
+    0xca273eceea26619cULL, 0xd186b8c721c0c207ULL, 0xeada7dd6cde0eb1eULL, 0xf57d4f7fee6ed178ULL,
+    0x06f067aa72176fbaULL, 0x0a637dc5a2c898a6ULL, 0x113f9804bef90daeULL, 0x1b710b35131c471bULL,
+    0x28db77f523047d84ULL, 0x32caab7b40c72493ULL, 0x3c9ebe0a15c9bebcULL, 0x431d67c49c100d4cULL,
+    0x4cc5d4becb3e42b6ULL, 0x597f299cfc657e2aULL, 0x5fcb6fab3ad6faecULL, 0x6c44198c4a475817ULL
+};
+
+/**
+ * @brief hash the rest of a message into state and pad it
+ * @param prefix bytes of the message already in state
+ */
+template <class H>
+void hash(typename H::Word *state, quint64 prefix, const uchar *data, size_t size)
+{
+    typedef typename H::Word Word;
+    const quint64 bits = (prefix + size) * 8;
+    uchar tail[2 * H::BlockBytes];
+    Word block[16];
+
+    for (; size >= size_t(H::BlockBytes); data += H::BlockBytes, size -= H::BlockBytes) {
+        for (int word = 0; word < 16; ++word)
+            block[word] = load<Word>(data + word * sizeof(Word));
+
+        H::compress(state, block);
+    }
+
+    const size_t tailSize = size + 1 + H::LengthBytes > size_t(H::BlockBytes) ? 2 * H::BlockBytes : H::BlockBytes;
+    std::memset(tail, 0, sizeof tail);
+    std::memcpy(tail, data, size);
+    tail[size] = 0x80;
+    store<quint64>(tail + tailSize - 8, bits);
+
+    for (size_t offset = 0; offset < tailSize; offset += H::BlockBytes) {
+        for (int word = 0; word < 16; ++word)
+            block[word] = load<Word>(tail + offset + word * sizeof(Word));
+
+        H::compress(state, block);
+    }
+}
+
+/**
+ * @brief The Chain struct is the iteration chain of one PBKDF2 output block
+ */
+template <class H>
+struct Chain
+{
+    typedef typename H::Word Word;
+
+    Word inner[H::StateWords]; ///< HMAC state after the inner padded key
+    Word outer[H::StateWords]; ///< HMAC state after the outer padded key
+    Word u[H::DigestWords];
+    Word t[H::DigestWords];
+    uint remaining;
+    uchar *derived;
+    size_t size;
+
+    void save() const
+    {
+        uchar digest[H::DigestWords * sizeof(Word)];
+
+        for (int word = 0; word < H::DigestWords; ++word)
+            store<Word>(digest + word * sizeof(Word), t[word]);
+
+        std::memcpy(derived, digest, size);
+    }
+};
+
+/**
+ * @brief append the chains of a job, with their first iteration done
+ */
+template <class H>
+void append(QVector<Chain<H> > &chains, const MultiPbkdf2::Job &job)
+{
+    typedef typename H::Word Word;
+    const size_t digestSize = H::DigestWords * sizeof(Word);
+    uchar key[H::BlockBytes];
+    uchar pad[H::BlockBytes];
+    uchar digest[H::DigestWords * sizeof(Word)];
+    Word block[16];
+    Chain<H> chain;
+    std::memset(key, 0, sizeof key);
+
+    if (job.passwordSize > size_t(H::BlockBytes)) {
+        Word state[H::StateWords];
+        std::copy(H::Initial, H::Initial + H::StateWords, state);
+        hash<H>(state, 0, reinterpret_cast<const uchar*>(job.password), job.passwordSize);
+
+        for (int word = 0; word < H::DigestWords; ++word)
+            store<Word>(key + word * sizeof(Word), state[word]);
+    } else {
+        std::memcpy(key, job.password, job.passwordSize);
+    }
+
+    for (int mask = 0; mask < 2; ++mask) {
+        Word *state = mask ? chain.outer : chain.inner;
+        std::copy(H::Initial, H::Initial + H::StateWords, state);
+
+        for (int byte = 0; byte < H::BlockBytes; ++byte)
+            pad[byte] = key[byte] ^ (mask ? 0x5c : 0x36);
+
+        for (int word = 0; word < 16; ++word)
+            block[word] = load<Word>(pad + word * sizeof(Word));
+
+        H::compress(state, block);
+    }
+
+    std::vector<uchar> message(job.salt, job.salt + job.saltSize);
+    message.resize(job.saltSize + 4);
+
+    for (size_t offset = 0, index = 1; offset < job.derivedSize; offset += digestSize, ++index) {
+        Word inner[H::StateWords];
+        Word outer[H::StateWords];
+        std::copy(chain.inner, chain.inner + H::StateWords, inner);
+        std::copy(chain.outer, chain.outer + H::StateWords, outer);
+        store<quint32>(&message[job.saltSize], quint32(index));
+        hash<H>(inner, H::BlockBytes, &message[0], message.size());
+
+        for (int word = 0; word < H::DigestWords; ++word)
+            store<Word>(digest + word * sizeof(Word), inner[word]);
+
+        hash<H>(outer, H::BlockBytes, digest, digestSize);
+        std::copy(outer, outer + H::DigestWords, chain.u);
+        std::copy(outer, outer + H::DigestWords, chain.t);
+        chain.remaining = qMax(job.iterations, 1U) - 1;
+        chain.derived = job.derived + offset;
+        chain.size = qMin(digestSize, job.derivedSize - offset);
+        chains.append(chain);
+    }
+}
+
+/**
+ * @brief The Lane struct reads and writes a lane of V, which may be a single Word
+ */
+template <typename V, typename W>
+struct Lane
+{
+    static QRYPTO_INLINE W get(const V &vector, int lane)
+    { return vector[lane]; }
+
+    static QRYPTO_INLINE void set(V &vector, int lane, W word)
+    { vector[lane] = word; }
+};
+
+template <typename W>
+struct Lane<W, W>
+{
+    static QRYPTO_INLINE W get(const W &word, int)
+    { return word; }
+
+    static QRYPTO_INLINE void set(W &word, int, W value)
+    { word = value; }
+};
+
+/**
+ * @brief The Lanes struct iterates as many chains as V has lanes,
+ * loading the next chain into a lane as soon as its chain ends
+ */
+template <class H, typename V>
+struct Lanes
+{
+    typedef typename H::Word Word;
+    typedef Lane<V, Word> Access;
+    enum { Count = sizeof(V) / sizeof(Word) };
+
+    V inner[H::StateWords];
+    V outer[H::StateWords];
+    V u[H::DigestWords];
+    V t[H::DigestWords];
+    V block[16];
+    Chain<H> *lane[Count];
+
+    QRYPTO_INLINE void iterate()
+    {
+        V state[H::StateWords];
+
+        for (int word = 0; word < H::DigestWords; ++word)
+            block[word] = u[word];
+
+        for (int word = 0; word < H::StateWords; ++word)
+            state[word] = inner[word];
+
+        H::compress(state, block);
+
+        for (int word = 0; word < H::DigestWords; ++word)
+            block[word] = state[word];
+
+        for (int word = 0; word < H::StateWords; ++word)
+            state[word] = outer[word];
+
+        H::compress(state, block);
+
+        for (int word = 0; word < H::DigestWords; ++word) {
+            u[word] = state[word];
+            t[word] ^= state[word];
+        }
+    }
+
+    /**
+     * @brief load the next unfinished chain into a lane, saving finished ones on the way
+     * @return false when no chain is left
+     */
+    QRYPTO_INLINE bool load(int i, Chain<H> *&next, Chain<H> *end)
+    {
+        for (lane[i] = 0; next != end && !lane[i]; ++next) {
+            if (!next->remaining) {
+                next->save();
+                continue;
+            }
+
+            lane[i] = next;
+
+            for (int word = 0; word < H::StateWords; ++word) {
+                Access::set(inner[word], i, next->inner[word]);
+                Access::set(outer[word], i, next->outer[word]);
+            }
+
+            for (int word = 0; word < H::DigestWords; ++word) {
+                Access::set(u[word], i, next->u[word]);
+                Access::set(t[word], i, next->t[word]);
+            }
+        }
+
+        return lane[i];
+    }
+
+    QRYPTO_INLINE void save(int i)
+    {
+        for (int word = 0; word < H::DigestWords; ++word)
+            lane[i]->t[word] = Access::get(t[word], i);
+
+        lane[i]->save();
+    }
+
+    static QRYPTO_INLINE void run(Chain<H> *next, Chain<H> *end)
+    {
+        Lanes lanes;
+        const Word padding = Word(0x80) << (sizeof(Word) * 8 - 8);
+        const Word bits = Word((H::BlockBytes + H::DigestWords * sizeof(Word)) * 8);
+        int active = 0;
+
+        for (int word = 0; word < 16; ++word) {
+            lanes.block[word] = V() + Word(word == H::DigestWords ? padding : word == 15 ? bits : 0);
+        }
+
+        for (int word = 0; word < H::StateWords; ++word)
+            lanes.inner[word] = lanes.outer[word] = V() + Word(0);
+
+        for (int word = 0; word < H::DigestWords; ++word)
+            lanes.u[word] = lanes.t[word] = V() + Word(0);
+
+        for (int i = 0; i < Count; ++i)
+            active += lanes.load(i, next, end);
+
+        while (active > 0) {
+            lanes.iterate();
+
+            for (int i = 0; i < Count; ++i) {
+                if (lanes.lane[i] && --lanes.lane[i]->remaining == 0) {
+                    lanes.save(i);
+                    active -= !lanes.load(i, next, end);
+                }
+            }
+        }
+    }
+};
+
+#ifdef QRYPTO_PBKDF2_VECTOR
+template <class H>
+void runPortable(Chain<H> *chains, int count)
+{
+    typedef typename H::Word Vector __attribute__((vector_size(16)));
+    Lanes<H, Vector>::run(chains, chains + count);
+}
+#else
+template <class H>
+void runPortable(Chain<H> *chains, int count)
+{
+    Lanes<H, typename H::Word>::run(chains, chains + count);
+}
+#endif
+
+#ifdef QRYPTO_PBKDF2_X86
+/*
+ * wide vectors are only declared within the functions of their target, where they are
+ * never passed by value, so that their calling convention doesn't depend on the target
+ */
+template <class H>
+__attribute__((target("avx2")))
+void runAvx2(Chain<H> *chains, int count)
+{
+    typedef typename H::Word Vector __attribute__((vector_size(32)));
+    Lanes<H, Vector>::run(chains, chains + count);
+}
+
+template <class H>
+__attribute__((target("avx512f")))
+void runAvx512(Chain<H> *chains, int count)
+{
+    typedef typename H::Word Vector __attribute__((vector_size(64)));
+    Lanes<H, Vector>::run(chains, chains + count);
+}
+
+Level detect()
+{
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx512f"))
+        return MultiPbkdf2::Avx512;
+    else if (__builtin_cpu_supports("avx2"))
+        return MultiPbkdf2::Avx2;
+    else
+        return MultiPbkdf2::Portable;
+}
+#else
+Level detect()
+{
+    return MultiPbkdf2::Portable;
+}
+#endif
+
+template <class H>
+int lanes(Level level)
+{
+#ifdef QRYPTO_PBKDF2_VECTOR
+    const int bytes = level == MultiPbkdf2::Avx512 ? 64 : level == MultiPbkdf2::Avx2 ? 32 : 16;
+#else
+    Q_UNUSED(level);
+    const int bytes = sizeof(typename H::Word);
+#endif
+    return bytes / int(sizeof(typename H::Word));
+}
+
+/**
+ * @brief The Slice struct is a share of the chains of one hash for a thread of the pool
+ */
+template <class H>
+struct Slice
+{
+    typedef void result_type;
+
+    Chain<H> *chains;
+    int count;
+    Level level;
+
+    void operator()(const Slice &slice) const
+    {
+        switch (slice.level) {
+#ifdef QRYPTO_PBKDF2_X86
+        case MultiPbkdf2::Avx512:
+            runAvx512<H>(slice.chains, slice.count);
+            break;
+        case MultiPbkdf2::Avx2:
+            runAvx2<H>(slice.chains, slice.count);
+            break;
+#endif
+        default:
+            runPortable<H>(slice.chains, slice.count);
+        }
+    }
+};
+
+/**
+ * @brief derive the jobs of hash H, in slices of whole lanes for each thread
+ */
+template <class H>
+void derive(const MultiPbkdf2::Job *jobs, int count, MultiPbkdf2::Hash hash, Level level)
+{
+    QVector<Chain<H> > chains;
+    QVector<Slice<H> > slices;
+
+    for (int job = 0; job < count; ++job) {
+        if (jobs[job].hash == hash)
+            append<H>(chains, jobs[job]);
+    }
+
+    const int width = lanes<H>(level);
+    const int threads = qMax(QThread::idealThreadCount(), 1);
+    const int share = ((chains.size() + threads - 1) / threads + width - 1) / width * width;
+
+    for (int offset = 0; offset < chains.size(); offset += share) {
+        Slice<H> slice;
+        slice.chains = chains.data() + offset;
+        slice.count = qMin(share, chains.size() - offset);
+        slice.level = level;
+        slices.append(slice);
+    }
+
+    QtConcurrent::blockingMap(slices, Slice<H>());
+}
+}
+
+MultiPbkdf2::Level MultiPbkdf2::level()
+{
+    static const Level supported = detect();
+    return supported;
+}
+
+int MultiPbkdf2::lanes(Hash hash)
+{
+    switch (hash) {
+    case Sha1:
+        return ::lanes< ::Sha1>(level());
+    case Sha224:
+    case Sha256:
+        return ::lanes< ::Sha256>(level());
+    default:
+        return ::lanes< ::Sha512>(level());
+    }
+}
+
+void MultiPbkdf2::derive(const Job *jobs, int count)
+{
+    derive(jobs, count, level());
+}
+
+void MultiPbkdf2::derive(const Job *jobs, int count, Level level)
+{
+    level = qMin(level, MultiPbkdf2::level());
+    ::derive< ::Sha1>(jobs, count, Sha1, level);
+    ::derive< ::Sha224>(jobs, count, Sha224, level);
+    ::derive< ::Sha256>(jobs, count, Sha256, level);
+    ::derive< ::Sha384>(jobs, count, Sha384, level);
+    ::derive< ::Sha512>(jobs, count, Sha512, level);
+}
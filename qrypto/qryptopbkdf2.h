@@ -0,0 +1,89 @@
+/* Qrypto 2019
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**/
+#ifndef QRYPTO_PBKDF2_H
+#define QRYPTO_PBKDF2_H
+
+#include <QtGlobal>
+
+#include <cstddef>
+
+namespace Qrypto
+{
+
+/**
+ * @brief The MultiPbkdf2 class runs the iteration chains of many PBKDF2-HMAC derivations
+ * side by side in the lanes of SIMD registers, with AVX-512 or AVX2 when the processor supports them
+ * @note every output block of every job is a chain, chains are spread over the thread pool
+ */
+class MultiPbkdf2
+{
+public:
+    enum Hash {
+        Sha1,
+        Sha224,
+        Sha256,
+        Sha384,
+        Sha512
+    };
+
+    /**
+     * @brief The Level enum of instructions running the lanes
+     */
+    enum Level {
+        Portable,
+        Avx2,
+        Avx512
+    };
+
+    /**
+     * @brief The Job struct is one key derivation
+     */
+    struct Job
+    {
+        Hash hash;
+        const char *password;
+        size_t passwordSize;
+        const char *salt;
+        size_t saltSize;
+        uint iterations;
+        uchar *derived;
+        size_t derivedSize;
+    };
+
+    /**
+     * @brief level of instructions supported by this processor, detected once
+     */
+    static Level level();
+
+    /**
+     * @brief lanes of hash chains run by one instruction stream on this processor
+     * @return 1 without SIMD support
+     */
+    static int lanes(Hash hash);
+
+    /**
+     * @brief derive all jobs, bit for bit like PKCS #5 PBKDF2-HMAC
+     * @param jobs
+     * @param count
+     */
+    static void derive(const Job *jobs, int count);
+
+    /**
+     * @brief derive all jobs with instructions up to level, for tests
+     * @param level beyond the supported level() is lowered to it
+     */
+    static void derive(const Job *jobs, int count, Level level);
+};
+
+}
+
+#endif // QRYPTO_PBKDF2_H
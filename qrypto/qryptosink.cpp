@@ -0,0 +1,155 @@
+#include "qryptosink.h"
+
+#include <QAtomicInt>
+#include <QIODevice>
+#include <QSemaphore>
+#include <QThread>
+
+#include "pointerator.h"
+
+using namespace Qrypto;
+
+Error DeviceSink::write(const char *data, qint64 size)
+{
+    if (m_error)
+        return m_error;
+
+    for (qint64 written = 0; size > 0; data += written, size -= written) {
+        written = m_device->write(data, size);
+
+        if (written <= 0)
+            return m_error = UnknownError;
+    }
+
+    return NoError;
+}
+
+Error DeviceSink::close()
+{
+    return m_error;
+}
+
+namespace
+{
+/// chunks of a PipeSink, as large as parallel chunks of a Pointerator
+const int PipeChunk = int(Pointerator<char>::ParallelChunk);
+
+/// chunks in flight between two stages
+const int PipeChunks = 4;
+}
+
+struct PipeSink::Impl : QThread
+{
+    Sink *next;
+    QByteArray ring[PipeChunks];
+    QSemaphore free;
+    QSemaphore used;
+    QAtomicInt error;
+    int head; ///< chunk being filled, owned by the writer
+    int tail; ///< chunk being written, owned by the worker
+    bool filling;
+    bool closing;
+
+    Impl(Sink *next) :
+        next(next),
+        free(PipeChunks),
+        error(NoError),
+        head(0),
+        tail(0),
+        filling(false),
+        closing(false)
+    {
+        for (int chunk = 0; chunk < PipeChunks; ++chunk)
+            ring[chunk].reserve(PipeChunk); // so that resize(0) keeps the buffer
+    }
+
+    QByteArray &chunk()
+    {
+        if (!filling)
+            free.acquire();
+
+        filling = true;
+        return ring[head];
+    }
+
+    void publish()
+    {
+        head = (head + 1) % PipeChunks;
+        filling = false;
+        used.release();
+    }
+
+    /**
+     * @brief finish hands over an empty chunk that ends the stream and waits for the worker
+     */
+    void finish(bool close)
+    {
+        chunk().resize(0);
+        closing = close;
+        publish();
+        wait();
+    }
+
+    void run()
+    {
+        for (;;) {
+            used.acquire();
+            QByteArray &data = ring[tail];
+            tail = (tail + 1) % PipeChunks;
+
+            if (data.isEmpty()) {
+                if (closing && !error.loadAcquire())
+                    error.storeRelease(next->close());
+
+                return;
+            } else if (!error.loadAcquire()) {
+                error.storeRelease(next->write(data.constData(), data.size()));
+            }
+
+            data.resize(0); // drains after an error, so the writer never blocks
+            free.release();
+        }
+    }
+};
+
+PipeSink::PipeSink(Sink *sink) :
+    d(new Impl(sink))
+{
+    d->start();
+}
+
+PipeSink::~PipeSink()
+{
+    if (!d->isFinished())
+        d->finish(false);
+
+    delete d;
+}
+
+Error PipeSink::write(const char *data, qint64 size)
+{
+    if (d->isFinished())
+        return Error(d->error.loadAcquire());
+
+    for (Pointerator<const char> it(data, size), chunk; !it.atEnd(); ) {
+        QByteArray &buffer = d->chunk();
+        chunk = it.read(PipeChunk - buffer.size());
+        buffer.append(chunk.data(), int(chunk.size()));
+
+        if (buffer.size() == PipeChunk)
+            d->publish();
+    }
+
+    return Error(d->error.loadAcquire());
+}
+
+Error PipeSink::close()
+{
+    if (d->filling && !d->ring[d->head].isEmpty())
+        d->publish();
+
+    if (!d->isFinished())
+        d->finish(true);
+
+    return Error(d->error.loadAcquire());
+}
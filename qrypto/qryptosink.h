@@ -0,0 +1,172 @@
+/* Qrypto 2019
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**/
+#ifndef QRYPTO_SINK_H
+#define QRYPTO_SINK_H
+
+#include "qrypto.h"
+#include "sequre.h"
+
+#include <limits>
+
+class QIODevice;
+
+namespace Qrypto
+{
+
+/**
+ * @brief The Sink class receives the output of a streaming stage
+ * @note a stage writes into the next Sink and closes it when closing itself,
+ * the next Sink is never owned
+ */
+class Sink
+{
+protected:
+    Error m_error;
+
+public:
+    Sink() :
+        m_error(NoError)
+    { }
+
+    virtual ~Sink()
+    { }
+
+    /**
+     * @brief write data into the stream
+     * @param data
+     * @param size in bytes
+     * @return first error of this or any following stage
+     */
+    virtual Error write(const char *data, qint64 size) = 0;
+
+    Error write(const QByteArray &data)
+    { return write(data.constData(), data.size()); }
+
+    /**
+     * @brief close flushes pending data and ends the stream
+     * @return first error of this or any following stage
+     */
+    virtual Error close() = 0;
+
+    /**
+     * @brief error raised by this stage itself
+     * @return NoError when a failure came from a following stage
+     */
+    Error error() const
+    { return m_error; }
+};
+
+/**
+ * @brief The BytesSink class appends the stream to SequreBytes
+ */
+class BytesSink : public Sink
+{
+    SequreBytes &m_bytes;
+
+public:
+    BytesSink(SequreBytes &bytes) :
+        m_bytes(bytes)
+    { }
+
+    Error write(const char *data, qint64 size)
+    {
+        if (size > std::numeric_limits<int>::max() - m_bytes.size())
+            return m_error = OutOfMemory; // beyond a QByteArray, stream into a DeviceSink instead
+
+        m_bytes.append(data, int(size));
+        return NoError;
+    }
+
+    Error close()
+    { return NoError; }
+};
+
+/**
+ * @brief The DeviceSink class writes the stream into a QIODevice
+ */
+class DeviceSink : public Sink
+{
+    QIODevice *m_device;
+
+public:
+    DeviceSink(QIODevice *device) :
+        m_device(device)
+    { }
+
+    Error write(const char *data, qint64 size);
+
+    Error close();
+
+    QIODevice *device() const
+    { return m_device; }
+};
+
+/**
+ * @brief The PipeSink class runs the following stages on a worker thread,
+ * handing the stream over in a bounded ring of chunks
+ * @note write returns errors of the following stages once the worker has met them,
+ * close waits for the worker, which closes the next Sink
+ */
+class PipeSink : public Sink
+{
+    struct Impl;
+    Impl *d;
+
+    Q_DISABLE_COPY(PipeSink)
+
+public:
+    /**
+     * @brief PipeSink starts the worker
+     * @param sink written and closed only by the worker
+     */
+    explicit PipeSink(Sink *sink);
+
+    /**
+     * @brief ~PipeSink discards the pending chunks without closing the next Sink, unless closed
+     */
+    ~PipeSink();
+
+    Error write(const char *data, qint64 size);
+
+    Error close();
+};
+
+/**
+ * @brief The TeeSink class writes the stream into two sinks in turn
+ */
+class TeeSink : public Sink
+{
+    Sink *m_first;
+    Sink *m_second;
+
+public:
+    TeeSink(Sink *first, Sink *second) :
+        m_first(first),
+        m_second(second)
+    { }
+
+    Error write(const char *data, qint64 size)
+    {
+        const Error error = m_first->write(data, size);
+        return error ? error : m_second->write(data, size);
+    }
+
+    Error close()
+    {
+        const Error error = m_first->close();
+        return error ? error : m_second->close();
+    }
+};
+
+}
+
+#endif // QRYPTO_SINK_H
@@ -1,12 +1,13 @@
 #include "sequre.h"
 
 #include <QString>
+#include <string>
 #include <vector>
 
 namespace Qrypto
 {
 template class Sequre<QByteArray>;
 template class Sequre<QString, int, QChar>;
-template class Sequre<std::string, size_t>;
-template class Sequre<std::vector<uchar>, size_t, uchar>;
+template class Sequre<std::basic_string<char, std::char_traits<char>, SequreAllocator<char> >, size_t>;
+template class Sequre<std::vector<uchar, SequreAllocator<uchar> >, size_t, uchar>;
 }
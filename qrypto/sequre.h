@@ -12,11 +12,29 @@
 #ifndef QRYPTO_SEQURE_H
 #define QRYPTO_SEQURE_H
 
+#include "sequrearena.h"
+
 #include <algorithm>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
 
 namespace Qrypto
 {
 
+/**
+ * @brief The ArenaWiped struct tells whether Str buffers are wiped by the SequreArena when released
+ */
+template <class Str>
+struct ArenaWiped { static const bool value = false; };
+
+template <typename C, class T>
+struct ArenaWiped<std::basic_string<C, T, SequreAllocator<C> > > { static const bool value = true; };
+
+template <typename T>
+struct ArenaWiped<std::vector<T, SequreAllocator<T> > > { static const bool value = true; };
+
 template <class Str, typename Len = int, typename Chr = char>
 /**
  * @brief The Sequre class sequrely clears memory before any deallocation
@@ -26,7 +44,31 @@ template <class Str, typename Len = int, typename Chr = char>
  */
 class Sequre
 {
-    Str *s;
+    mutable Str *s; ///< 0 once moved from, until used again
+
+    /**
+     * @brief buffer allocates an empty string for a moved-from Sequre
+     */
+    Str *buffer() const
+    {
+        if (!s)
+            s = new Str;
+
+        return s;
+    }
+
+    /**
+     * @brief reallocate into a new buffer of capacity, wiping the old one
+     * @param size not less than the current size
+     */
+    void reallocate(Len size, Len capacity)
+    {
+        Str t;
+        t.reserve(capacity);
+        t.resize(size);
+        std::copy(buffer()->begin(), buffer()->end(), t.begin());
+        clear()->swap(t);
+    }
 
 public:
 
@@ -51,8 +93,46 @@ public:
         s(new Str(*copy))
     { }
 
+#ifdef Q_COMPILER_RVALUE_REFS
+    /**
+     * @brief Sequre takes over the buffer of str, the moved-from string is left empty
+     */
+    explicit Sequre(Str &&str) :
+        s(new Str(std::move(str)))
+    { }
+
+    /**
+     * @brief Sequre takes over the buffer of other without allocating, leaving it empty
+     */
+    Sequre(Cls &&other) Q_DECL_NOTHROW :
+        s(other.s)
+    { other.s = 0; }
+
+    /**
+     * @brief operator= exchanges buffers, the previous one is wiped along with other
+     */
+    Cls &operator=(Cls &&other) Q_DECL_NOTHROW
+    {
+        std::swap(s, other.s);
+        return *this;
+    }
+
+    /**
+     * @brief operator= takes over the buffer of str, wiping the previous one
+     */
+    Cls &operator=(Str &&str)
+    {
+        Cls t(std::move(str));
+        std::swap(s, t.s);
+        return *this;
+    }
+#endif
+
     ~Sequre()
-    { delete clear().s; }
+    {
+        if (s)
+            delete clear().s;
+    }
 
     Cls &operator=(const Cls &str)
     { return assign(*str); }
@@ -67,13 +147,13 @@ public:
     { return append(str); }
 
     Str &operator*() const
-    { return *s; }
+    { return *buffer(); }
 
     Str *operator->() const
-    { return s; }
+    { return buffer(); }
 
     Chr &operator[](int id)
-    { return *((id < 0 ? s->end() : s->begin()) + id); }
+    { return *((id < 0 ? buffer()->end() : buffer()->begin()) + id); }
 
     Cls &append(Chr ch)
     { return append(&ch, 1); }
@@ -84,7 +164,7 @@ public:
     Cls &append(const Chr *str, Len size)
     {
         if (str && size > 0)
-            std::copy(str, str + size, resize(s->size() + size)->end() - size);
+            std::copy(str, str + size, resize(buffer()->size() + size)->end() - size);
 
         return *this;
     }
@@ -96,21 +176,36 @@ public:
     }
 
     iterator begin()
-    { return s->begin(); }
+    { return buffer()->begin(); }
 
     iterator end()
-    { return s->end(); }
+    { return buffer()->end(); }
 
+    /**
+     * @brief clear wipes the whole capacity once and releases it
+     * @note arena buffers are only released, SequreArena::deallocate wipes them,
+     * while short strings stored inline are wiped here
+     */
     Cls &clear()
     {
+        if (!s)
+            return *this;
+
+        const quintptr data = quintptr(s->data());
+
+        if (ArenaWiped<Str>::value && (data < quintptr(s) || data >= quintptr(s + 1))) {
+            Str().swap(*s);
+            return *this;
+        }
+
         for (Len size = fill(0, s->capacity())->size(); size && s->at(size / 2) == Chr(0); size = 0)
-            s->clear(); // the code above should be complex enough to avoid optimisation
+            Str().swap(*s); // the code above should be complex enough to avoid optimisation
 
         return *this;
     }
 
     Cls &fill(Chr ch)
-    { return fill(ch, s->size()); }
+    { return fill(ch, buffer()->size()); }
 
     Cls &fill(Chr ch, Len size)
     {
@@ -127,9 +222,9 @@ public:
     iterator insert(Len pos, const Chr *str, Len size)
     {
         if (str && size > 0) {
-            resize(s->size() + size);
-            std::copy(str, str + size,
-                      std::copy_backward(s->begin() + pos, s->begin() + (pos + size), s->end()));
+            resize(buffer()->size() + size);
+            std::copy_backward(buffer()->begin() + pos, buffer()->end() - size, buffer()->end());
+            std::copy(str, str + size, buffer()->begin() + pos);
         }
 
         return begin() + (pos + size);
@@ -145,36 +240,36 @@ public:
     {
         if (str && size > 0) {
             Str t;
-            t.resize(s->size() + size);
-            std::copy(s->begin(), s->end(), std::copy(str, str + size, t.begin()));
+            t.resize(buffer()->size() + size);
+            std::copy(buffer()->begin(), buffer()->end(), std::copy(str, str + size, t.begin()));
             clear()->swap(t);
         }
 
         return *this;
     }
 
+    /**
+     * @brief reserve exactly capacity, when the final size is known
+     */
     Cls &reserve(Len capacity)
     {
-        if (capacity > s->capacity()) {
-            Str t;
-            t.reserve(capacity);
-            t.resize(s->size());
-            std::copy(s->begin(), s->end(), t.begin());
-            clear()->swap(t);
-        }
+        if (capacity > buffer()->capacity())
+            reallocate(buffer()->size(), capacity);
 
         return *this;
     }
 
+    /**
+     * @brief resize growing the capacity geometrically, so appending is amortised linear
+     */
     Cls &resize(Len size)
     {
-        if (size > s->capacity()) {
-            Str t;
-            t.resize(size);
-            std::copy(s->begin(), s->end(), t.begin());
-            clear()->swap(t);
+        if (size > buffer()->capacity()) {
+            const Len capacity = buffer()->capacity();
+            reallocate(size, std::max(size, capacity < std::numeric_limits<Len>::max() / 2 ?
+                                                Len(capacity + capacity / 2) : size));
         } else {
-            s->resize(size); // assumes no reallocation when resizing within capacity
+            buffer()->resize(size); // assumes no reallocation when resizing within capacity
         }
 
         return *this;
@@ -190,13 +285,13 @@ public:
         const int size = last - first;
 
         if (size > 0)
-            std::copy(first, last, resize(s->size() + size)->end() - size);
+            std::copy(first, last, resize(buffer()->size() + size)->end() - size);
 
         return *this;
     }
 
     Len capacity() const
-    { return s->capacity(); }
+    { return s ? s->capacity() : 0; }
 
     iterator insert(iterator it, const Chr *first, const Chr *last)
     {
@@ -209,7 +304,110 @@ public:
     }
 
     Len size() const
-    { return s->size(); }
+    { return s ? s->size() : 0; }
+};
+
+template <size_t N, typename Chr = uchar>
+/**
+ * @brief The SequreArray class holds a small secret inline, up to a fixed capacity,
+ * so it is never allocated on the heap and is wiped when cleared or destroyed
+ * @param N capacity
+ * @param Chr value type
+ */
+class SequreArray
+{
+    Chr m_data[N];
+    size_t m_size;
+
+    void wipe(size_t from)
+    {
+        for (volatile Chr *ch = m_data + from; ch != m_data + N; )
+            *ch++ = Chr(0);
+    }
+
+public:
+
+    typedef SequreArray<N, Chr> Cls;
+    typedef size_t size_type;
+    typedef Chr    value_type;
+    typedef Chr   *iterator;
+
+    static const size_t Capacity = N;
+
+    SequreArray(size_t size = 0, Chr ch = Chr(0)) :
+        m_size(std::min(size, N))
+    {
+        std::fill_n(m_data, m_size, ch);
+        wipe(m_size);
+    }
+
+    SequreArray(const Cls &copy) :
+        m_size(copy.m_size)
+    {
+        std::copy(copy.m_data, copy.m_data + m_size, m_data);
+        wipe(m_size);
+    }
+
+    ~SequreArray()
+    { wipe(0); }
+
+    Cls &operator=(const Cls &copy)
+    {
+        if (this != &copy) {
+            std::copy(copy.m_data, copy.m_data + copy.m_size, m_data);
+            wipe(m_size = copy.m_size);
+        }
+
+        return *this;
+    }
+
+    Chr &operator[](size_t id)
+    { return m_data[id]; }
+
+    const Chr &operator[](size_t id) const
+    { return m_data[id]; }
+
+    iterator begin()
+    { return m_data; }
+
+    iterator end()
+    { return m_data + m_size; }
+
+    Chr *data()
+    { return m_data; }
+
+    const Chr *data() const
+    { return m_data; }
+
+    size_t size() const
+    { return m_size; }
+
+    size_t capacity() const
+    { return N; }
+
+    /**
+     * @brief clear wipes the whole capacity
+     */
+    Cls &clear()
+    {
+        wipe(m_size = 0);
+        return *this;
+    }
+
+    /**
+     * @brief resize within capacity, new values are zero and truncated ones wiped
+     * @param size clamped to the capacity
+     */
+    Cls &resize(size_t size)
+    {
+        const size_t old = m_size;
+        m_size = std::min(size, N);
+
+        if (m_size < old)
+            wipe(m_size);
+
+        return *this;
+    }
 };
 
 }
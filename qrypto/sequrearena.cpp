@@ -0,0 +1,216 @@
+#include "sequrearena.h"
+
+#include <QMutex>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QVector>
+
+#include <cstring>
+
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace Qrypto;
+
+namespace
+{
+/// size classes from Alignment to 64 MiB, larger blocks are mapped on their own
+const int Classes = 21;
+
+/// blocks smaller than a page are carved from chunks
+const size_t ChunkSize = 65536;
+
+/// blocks from this size are wiped on a pool thread
+const size_t AsyncWipeSize = 262144;
+
+/// bytes of free blocks mapped on their own kept for reuse
+const size_t CacheLimit = 64 << 20;
+}
+
+struct SequreArena::Impl
+{
+    QMutex mutex;
+    QVector<void*> free[Classes];
+    size_t cached;
+    size_t pageSize;
+
+    /**
+     * @brief The Wiper class wipes a large block before recycling or unmapping it
+     */
+    class Wiper : public QRunnable
+    {
+        Impl *d;
+        void *block;
+        size_t size;
+        int sizeClass;
+
+    public:
+        Wiper(Impl *d, void *block, size_t size, int sizeClass) :
+            d(d),
+            block(block),
+            size(size),
+            sizeClass(sizeClass)
+        { }
+
+        void run()
+        {
+            wipe(block, size);
+
+            if (sizeClass < 0)
+                unmap(block, size);
+            else
+                d->recycle(block, sizeClass);
+        }
+    };
+
+    Impl() :
+        cached(0),
+#ifdef Q_OS_UNIX
+        pageSize(size_t(sysconf(_SC_PAGESIZE)))
+#else
+        pageSize(4096)
+#endif
+    { }
+
+    static size_t classSize(int sizeClass)
+    { return Alignment << sizeClass; }
+
+    /**
+     * @return -1 for blocks mapped on their own
+     */
+    static int sizeClassOf(size_t size)
+    {
+        int sizeClass = 0;
+
+        while (sizeClass < Classes && classSize(sizeClass) < size)
+            ++sizeClass;
+
+        return sizeClass < Classes ? sizeClass : -1;
+    }
+
+    size_t pages(size_t size) const
+    { return (size + pageSize - 1) / pageSize * pageSize; }
+
+    static void *map(size_t size)
+    {
+#ifdef Q_OS_UNIX
+        void *pages = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+        if (pages == MAP_FAILED)
+            throw std::bad_alloc();
+
+        mlock(pages, size); // at best within RLIMIT_MEMLOCK
+#ifdef MADV_DONTDUMP
+        madvise(pages, size, MADV_DONTDUMP);
+#endif
+#else
+        void *pages = qMallocAligned(size, Alignment);
+
+        if (!pages)
+            throw std::bad_alloc();
+#endif
+        return pages;
+    }
+
+    static void unmap(void *pages, size_t size)
+    {
+#ifdef Q_OS_UNIX
+        munlock(pages, size);
+        munmap(pages, size);
+#else
+        Q_UNUSED(size);
+        qFreeAligned(pages);
+#endif
+    }
+
+    static void wipe(void *block, size_t size)
+    {
+#if defined(Q_CC_GNU) || defined(Q_CC_CLANG)
+        std::memset(block, 0, size);
+        asm volatile("" : : "r"(block) : "memory"); // the memset must not be elided
+#else
+        for (volatile char *byte = static_cast<volatile char*>(block); size--; )
+            *byte++ = 0;
+#endif
+    }
+
+    /**
+     * @brief recycle a wiped block into its free list, or unmap it beyond the CacheLimit
+     */
+    void recycle(void *block, int sizeClass)
+    {
+        const size_t size = classSize(sizeClass);
+        QMutexLocker locker(&mutex);
+
+        if (size >= pageSize && cached + size > CacheLimit) {
+            locker.unlock();
+            unmap(block, size);
+        } else {
+            if (size >= pageSize)
+                cached += size;
+
+            free[sizeClass].append(block);
+        }
+    }
+};
+
+SequreArena::SequreArena() :
+    d(new Impl)
+{ }
+
+SequreArena::~SequreArena()
+{
+    delete d;
+}
+
+SequreArena &SequreArena::instance()
+{
+    static SequreArena *arena = new SequreArena; // outlives static containers
+    return *arena;
+}
+
+void *SequreArena::allocate(size_t size)
+{
+    const int sizeClass = Impl::sizeClassOf(qMax<size_t>(size, 1));
+
+    if (sizeClass < 0)
+        return Impl::map(d->pages(size));
+
+    const size_t blockSize = Impl::classSize(sizeClass);
+    QMutexLocker locker(&d->mutex);
+    QVector<void*> &blocks = d->free[sizeClass];
+
+    if (blocks.isEmpty() && blockSize >= d->pageSize) {
+        locker.unlock();
+        return Impl::map(blockSize);
+    } else if (blocks.isEmpty()) {
+        const size_t chunkSize = qMax(ChunkSize, d->pageSize);
+        char *chunk = static_cast<char*>(Impl::map(chunkSize));
+
+        for (size_t offset = chunkSize; offset > 0; offset -= blockSize)
+            blocks.append(chunk + offset - blockSize);
+    } else if (blockSize >= d->pageSize) {
+        d->cached -= blockSize;
+    }
+
+    void *block = blocks.last();
+    blocks.removeLast();
+    return block;
+}
+
+void SequreArena::deallocate(void *block, size_t size)
+{
+    const int sizeClass = Impl::sizeClassOf(qMax<size_t>(size, 1));
+    const size_t blockSize = sizeClass < 0 ? d->pages(size) : Impl::classSize(sizeClass);
+
+    if (!block) {
+        return;
+    } else if (blockSize >= AsyncWipeSize) {
+        QThreadPool::globalInstance()->start(new Impl::Wiper(d, block, blockSize, sizeClass));
+    } else {
+        Impl::wipe(block, blockSize);
+        d->recycle(block, sizeClass);
+    }
+}
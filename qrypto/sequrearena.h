@@ -0,0 +1,121 @@
+/* Qrypto 2019
+**
+** GNU Lesser General Public License Usage
+** This file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 or version 3 as published by the Free
+** Software Foundation and appearing in the file LICENSE.LGPLv21 and
+** LICENSE.LGPLv3 included in the packaging of this file. Please review the
+** following information to ensure the GNU Lesser General Public License
+** requirements will be met: https://www.gnu.org/licenses/lgpl.html and
+** http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**/
+#ifndef QRYPTO_SEQURE_ARENA_H
+#define QRYPTO_SEQURE_ARENA_H
+
+#include <QtGlobal>
+
+#include <cstddef>
+#include <new>
+
+namespace Qrypto
+{
+
+/**
+ * @brief The SequreArena class recycles locked memory pages excluded from core dumps
+ * @note blocks are cache line aligned and wiped when deallocated, large ones on a pool thread
+ */
+class SequreArena
+{
+    struct Impl;
+    Impl *d;
+
+    SequreArena();
+    ~SequreArena();
+
+    Q_DISABLE_COPY(SequreArena)
+
+public:
+    static const size_t Alignment = 64;
+
+    /**
+     * @brief instance shared by all SequreAllocator, never destroyed
+     */
+    static SequreArena &instance();
+
+    /**
+     * @brief allocate a block of at least size bytes
+     * @throw std::bad_alloc when no pages can be mapped
+     */
+    void *allocate(size_t size);
+
+    /**
+     * @brief deallocate a block wiping it before reuse
+     * @param block from allocate
+     * @param size as allocated
+     */
+    void deallocate(void *block, size_t size);
+};
+
+/**
+ * @brief The SequreAllocator class allocates std containers in the SequreArena
+ */
+template <typename T>
+class SequreAllocator
+{
+public:
+    typedef T value_type;
+    typedef T *pointer;
+    typedef const T *const_pointer;
+    typedef T &reference;
+    typedef const T &const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+
+    template <typename U>
+    struct rebind { typedef SequreAllocator<U> other; };
+
+    SequreAllocator()
+    { }
+
+    template <typename U>
+    SequreAllocator(const SequreAllocator<U> &)
+    { }
+
+    pointer address(reference value) const
+    { return &value; }
+
+    const_pointer address(const_reference value) const
+    { return &value; }
+
+    pointer allocate(size_type n, const void * = 0)
+    {
+        if (n > max_size())
+            throw std::bad_alloc();
+
+        return static_cast<pointer>(SequreArena::instance().allocate(n * sizeof(T)));
+    }
+
+    void deallocate(pointer p, size_type n)
+    { SequreArena::instance().deallocate(p, n * sizeof(T)); }
+
+    size_type max_size() const
+    { return size_type(-1) / sizeof(T); }
+
+    void construct(pointer p, const T &value)
+    { new (p) T(value); }
+
+    void destroy(pointer p)
+    { p->~T(); }
+};
+
+template <typename T, typename U>
+inline bool operator==(const SequreAllocator<T> &, const SequreAllocator<U> &)
+{ return true; }
+
+template <typename T, typename U>
+inline bool operator!=(const SequreAllocator<T> &, const SequreAllocator<U> &)
+{ return false; }
+
+}
+
+#endif // QRYPTO_SEQURE_ARENA_H
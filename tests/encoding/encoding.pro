@@ -0,0 +1,13 @@
+QT += testlib
+QT -= gui
+
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+TARGET = tst_encoding
+TEMPLATE = app
+
+#include(../../qrypto/botan.pri)
+include(../../qrypto/cryptopp.pri)
+
+SOURCES   += $$PWD/tst_encoding.cpp
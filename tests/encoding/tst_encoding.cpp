@@ -0,0 +1,202 @@
+#include "../../qrypto/qryptoencoding.h"
+
+#include <QtTest>
+
+using Qrypto::Encoding;
+
+namespace
+{
+/// sizes of data beyond the 12, 16, 24, 28 and 32-byte blocks of the SIMD codecs several times
+const int MaxSize = 100;
+
+/// white space accepted by the decoders
+const char Spaces[] = " \t\n\r\v\f";
+
+/**
+ * @brief data of all byte values
+ */
+QByteArray data(int size)
+{
+    QByteArray data(size, Qt::Uninitialized);
+
+    for (int i = 0; i < size; ++i)
+        data[i] = char(i * 167 + 13);
+
+    return data;
+}
+
+/**
+ * @brief base64 of data by QByteArray, a line feed before each line of lineSize bytes of data
+ */
+QByteArray base64(const QByteArray &data, int lineSize)
+{
+    QByteArray text;
+
+    if (!lineSize)
+        return data.toBase64();
+
+    for (int offset = 0; offset < data.size(); offset += lineSize)
+        text += '\n' + data.mid(offset, lineSize).toBase64();
+
+    return text;
+}
+}
+
+/**
+ * @brief The tst_Encoding class checks the Base64 and hex codecs against QByteArray
+ * around the blocks of the SIMD codecs
+ */
+class tst_Encoding : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void base64_data();
+    void base64();
+    void base64Space();
+    void base64Invalid_data();
+    void base64Invalid();
+    void hex();
+    void hexSpace();
+    void hexInvalid_data();
+    void hexInvalid();
+};
+
+void tst_Encoding::base64_data()
+{
+    QTest::addColumn<int>("lineSize");
+
+    QTest::newRow("single line") << 0;
+    QTest::newRow("3") << 3;
+    QTest::newRow("12") << 12;
+    QTest::newRow("24") << 24;
+    QTest::newRow("27") << 27;
+    QTest::newRow("48") << 48;
+    QTest::newRow("57") << 57;
+}
+
+void tst_Encoding::base64()
+{
+    QFETCH(int, lineSize);
+
+    for (int size = 0; size <= MaxSize; ++size) {
+        const QByteArray bytes = data(size);
+        const QByteArray text = Encoding::toBase64(bytes.constData(), size, lineSize);
+        QByteArray decoded("prefix");
+
+        QCOMPARE(text, base64(bytes, lineSize));
+        QCOMPARE(size_t(text.size()), Encoding::base64Size(size_t(size), size_t(lineSize)));
+        QVERIFY(Encoding::fromBase64(decoded, text.constData(), text.size()));
+        QCOMPARE(decoded, "prefix" + bytes);
+    }
+}
+
+void tst_Encoding::base64Space()
+{
+    const QByteArray bytes = data(MaxSize);
+    const QByteArray text = bytes.toBase64();
+
+    for (int position = 0; position <= text.size(); ++position) {
+        QByteArray spaced(text);
+        QByteArray decoded;
+        spaced.insert(position, Spaces[position % (sizeof Spaces - 1)]);
+        QVERIFY(Encoding::fromBase64(decoded, spaced.constData(), spaced.size()));
+        QCOMPARE(decoded, bytes);
+    }
+}
+
+void tst_Encoding::base64Invalid_data()
+{
+    QTest::addColumn<char>("character");
+
+    QTest::newRow("!") << '!';
+    QTest::newRow("-") << '-';
+    QTest::newRow("_") << '_';
+    QTest::newRow(".") << '.';
+    QTest::newRow("@") << '@';
+    QTest::newRow("[") << '[';
+    QTest::newRow("`") << '`';
+    QTest::newRow("{") << '{';
+    QTest::newRow("NUL") << '\0';
+    QTest::newRow("DEL") << '\x7f';
+    QTest::newRow("0x80") << '\x80';
+    QTest::newRow("0xff") << '\xff';
+}
+
+void tst_Encoding::base64Invalid()
+{
+    QFETCH(char, character);
+    const QByteArray text = data(MaxSize).toBase64();
+
+    for (int position = 0; position < text.size(); ++position) {
+        QByteArray invalid(text);
+        QByteArray decoded("prefix");
+        invalid[position] = character;
+        QVERIFY2(!Encoding::fromBase64(decoded, invalid.constData(), invalid.size()),
+                 QByteArray::number(position).constData());
+        QCOMPARE(decoded, QByteArray("prefix"));
+    }
+}
+
+void tst_Encoding::hex()
+{
+    for (int size = 0; size <= MaxSize; ++size) {
+        const QByteArray bytes = data(size);
+        const QByteArray text = Encoding::toHex(bytes.constData(), size);
+        const QByteArray upper = text.toUpper();
+        QByteArray decoded("prefix");
+
+        QCOMPARE(text, bytes.toHex());
+        QVERIFY(Encoding::fromHex(decoded, upper.constData(), upper.size()));
+        QCOMPARE(decoded, "prefix" + bytes);
+    }
+}
+
+void tst_Encoding::hexSpace()
+{
+    const QByteArray bytes = data(MaxSize);
+    const QByteArray text = bytes.toHex();
+
+    for (int position = 0; position <= text.size(); ++position) {
+        QByteArray spaced(text);
+        QByteArray decoded;
+        spaced.insert(position, Spaces[position % (sizeof Spaces - 1)]);
+        QVERIFY(Encoding::fromHex(decoded, spaced.constData(), spaced.size()));
+        QCOMPARE(decoded, bytes);
+    }
+}
+
+void tst_Encoding::hexInvalid_data()
+{
+    QTest::addColumn<char>("character");
+
+    QTest::newRow("g") << 'g';
+    QTest::newRow("G") << 'G';
+    QTest::newRow("x") << 'x';
+    QTest::newRow("/") << '/';
+    QTest::newRow(":") << ':';
+    QTest::newRow("@") << '@';
+    QTest::newRow("`") << '`';
+    QTest::newRow("=") << '=';
+    QTest::newRow("NUL") << '\0';
+    QTest::newRow("0xff") << '\xff';
+}
+
+void tst_Encoding::hexInvalid()
+{
+    QFETCH(char, character);
+    const QByteArray text = data(MaxSize).toHex();
+
+    for (int position = 0; position < text.size(); ++position) {
+        QByteArray invalid(text);
+        QByteArray decoded("prefix");
+        invalid[position] = character;
+        QVERIFY2(!Encoding::fromHex(decoded, invalid.constData(), invalid.size()),
+                 QByteArray::number(position).constData());
+        QCOMPARE(decoded, QByteArray("prefix"));
+    }
+}
+
+QTEST_GUILESS_MAIN(tst_Encoding)
+
+#include "tst_encoding.moc"
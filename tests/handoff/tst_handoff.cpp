@@ -0,0 +1,173 @@
+#include "../../qrypto/qryptocipher.h"
+#include "../../qrypto/qryptocompress.h"
+#include "../../qrypto/qryptokeymaker.h"
+
+#include <QAtomicInt>
+#include <QtTest>
+
+#include <cstdlib>
+
+namespace
+{
+/// plain data, large enough for the parallel slices and segments
+const int PlainSize = 4 << 20;
+
+/// allocations from this size are counted, 0 while not counting
+QBasicAtomicInt countedSize = Q_BASIC_ATOMIC_INITIALIZER(0);
+
+QBasicAtomicInt counted = Q_BASIC_ATOMIC_INITIALIZER(0);
+
+void count(size_t size)
+{
+    const int from = countedSize.loadAcquire();
+
+    if (from && size >= size_t(from))
+        counted.ref();
+}
+
+/**
+ * @brief The Allocations struct counts the full-size buffers allocated while it exists
+ * @note QByteArray allocates with malloc and realloc, so they are interposed rather than operator new
+ */
+struct Allocations
+{
+    explicit Allocations(int size)
+    {
+        counted.storeRelease(0);
+        countedSize.storeRelease(size);
+    }
+
+    ~Allocations()
+    { countedSize.storeRelease(0); }
+
+    int count() const
+    { return counted.loadAcquire(); }
+};
+}
+
+#ifdef __GLIBC__
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t number, size_t size);
+void *__libc_realloc(void *block, size_t size);
+
+void *malloc(size_t size)
+{
+    count(size);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t number, size_t size)
+{
+    count(number * size);
+    return __libc_calloc(number, size);
+}
+
+void *realloc(void *block, size_t size)
+{
+    count(size);
+    return __libc_realloc(block, size);
+}
+}
+#endif
+
+/**
+ * @brief The tst_Handoff class checks that each stage allocates its output once, without intermediate copies
+ */
+class tst_Handoff : public QObject
+{
+    Q_OBJECT
+
+    QByteArray m_plain;
+    Qrypto::KeyMaker m_keyMaker;
+
+private slots:
+    void initTestCase();
+    void cipher_data();
+    void cipher();
+    void compress_data();
+    void compress();
+};
+
+void tst_Handoff::initTestCase()
+{
+#ifndef __GLIBC__
+    QSKIP("allocations are only counted with glibc");
+#endif
+    m_plain.reserve(PlainSize + 64);
+
+    for (int line = 0; m_plain.size() < PlainSize; ++line)
+        m_plain += "<p>Line " + QByteArray::number(line) + " of a compressible document</p>\n";
+
+    m_plain.resize(PlainSize);
+    m_keyMaker.setIterationCount(1000);
+    QCOMPARE(m_keyMaker.deriveKey(QByteArray("password")), Qrypto::NoError);
+}
+
+void tst_Handoff::cipher_data()
+{
+    QTest::addColumn<int>("operation");
+
+    QTest::newRow("CBC") << int(Qrypto::Cipher::CBC);
+    QTest::newRow("CTR") << int(Qrypto::Cipher::CTR);
+    QTest::newRow("GCM") << int(Qrypto::Cipher::GCM);
+    QTest::newRow("STREAM") << int(Qrypto::Cipher::STREAM);
+}
+
+void tst_Handoff::cipher()
+{
+    QFETCH(int, operation);
+    Qrypto::Cipher cipher(Qrypto::Cipher::AES, Qrypto::Cipher::Operation(operation));
+    Qrypto::SequreBytes plain;
+    QByteArray crypt;
+
+    {
+        const Allocations allocations(PlainSize / 2);
+        QCOMPARE(cipher.encrypt(crypt, m_plain.constData(), m_plain.size(), m_keyMaker), Qrypto::NoError);
+        QCOMPARE(allocations.count(), 1);
+    }
+
+    {
+        const Allocations allocations(PlainSize / 2);
+        QCOMPARE(cipher.decrypt(plain, crypt, m_keyMaker), Qrypto::NoError);
+        QCOMPARE(allocations.count(), 1);
+    }
+
+    QVERIFY(*plain == m_plain);
+}
+
+void tst_Handoff::compress_data()
+{
+    QTest::addColumn<int>("algorithm");
+
+    QTest::newRow("Deflate") << int(Qrypto::Compress::Deflate);
+    QTest::newRow("Identity") << int(Qrypto::Compress::Identity);
+    QTest::newRow("ZLib") << int(Qrypto::Compress::ZLib);
+}
+
+void tst_Handoff::compress()
+{
+    QFETCH(int, algorithm);
+    Qrypto::Compress compress(Qrypto::Compress::Algorithm(algorithm));
+    Qrypto::SequreBytes deflated;
+    Qrypto::SequreBytes inflated;
+
+    {
+        const Allocations allocations(PlainSize / 2);
+        QCOMPARE(compress.deflate(deflated, m_plain), Qrypto::NoError);
+        QCOMPARE(allocations.count(), 1);
+    }
+
+    {
+        const Allocations allocations(PlainSize / 2);
+        inflated.reserve(PlainSize); // the Trailer Length is known before inflating
+        QCOMPARE(compress.inflate(inflated, *deflated), Qrypto::NoError);
+        QCOMPARE(allocations.count(), 1);
+    }
+
+    QVERIFY(*inflated == m_plain);
+}
+
+QTEST_GUILESS_MAIN(tst_Handoff)
+
+#include "tst_handoff.moc"
@@ -0,0 +1,12 @@
+QT += testlib gui
+
+CONFIG += console testcase
+CONFIG -= app_bundle
+
+TARGET = tst_htmlcompress
+TEMPLATE = app
+
+#include(../../qrypto/botan.pri)
+include(../../qrypto/cryptopp.pri)
+
+SOURCES   += $$PWD/tst_htmlcompress.cpp
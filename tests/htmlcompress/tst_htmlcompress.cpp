@@ -0,0 +1,139 @@
+#include "../../qrypto/qryptocompress.h"
+#include "../../qrypto/sequre.h"
+
+#include <QTextCursor>
+#include <QTextDocument>
+#include <QTextTable>
+#include <QtTest>
+
+namespace
+{
+/// sections of the document, a few MiB of HTML
+const int SectionCount = 2000;
+
+/**
+ * @brief html of a rich text document as QTextDocument writes it, with headings,
+ * formatted paragraphs, lists and tables
+ */
+QByteArray html()
+{
+    QTextDocument document;
+    QTextCursor cursor(&document);
+    QTextCharFormat heading;
+    QTextCharFormat emphasis;
+    QTextCharFormat plain;
+    heading.setFontPointSize(16);
+    heading.setFontWeight(QFont::Bold);
+    emphasis.setFontItalic(true);
+    emphasis.setForeground(Qt::darkBlue);
+
+    for (int section = 0; section < SectionCount; ++section) {
+        cursor.insertBlock(QTextBlockFormat()); // out of the list of the previous section
+        cursor.insertText(QString("Section %1").arg(section), heading);
+        cursor.insertBlock(QTextBlockFormat());
+        cursor.insertText(QString("Paragraph %1 of plain text, ").arg(section), plain);
+        cursor.insertText("some of it emphasised", emphasis);
+        cursor.insertText(QString(" and the rest plain again, up to %1 words.").arg(section * 7 % 101), plain);
+
+        cursor.insertList(QTextListFormat::ListDisc);
+
+        for (int item = 0; item < 3; ++item) {
+            if (item)
+                cursor.insertBlock();
+
+            cursor.insertText(QString("Item %1.%2").arg(section).arg(item), plain);
+        }
+
+        if (section % 4 == 0) {
+            QTextTable *table = cursor.insertTable(2, 3);
+
+            for (int cell = 0; cell < 6; ++cell)
+                table->cellAt(cell / 3, cell % 3).firstCursorPosition().insertText(QString::number(section * 6 + cell));
+
+            cursor.movePosition(QTextCursor::End);
+        }
+    }
+
+    return document.toHtml().toUtf8();
+}
+}
+
+/**
+ * @brief The tst_HtmlCompress class benchmarks each algorithm on QTextDocument::toHtml output,
+ * the usual content of Qryptic documents
+ */
+class tst_HtmlCompress : public QObject
+{
+    Q_OBJECT
+
+    QByteArray m_html;
+
+private slots:
+    void initTestCase();
+    void deflate_data();
+    void deflate();
+    void inflate_data();
+    void inflate();
+};
+
+void tst_HtmlCompress::initTestCase()
+{
+    m_html = html();
+    qDebug("%d bytes of HTML", m_html.size());
+}
+
+void tst_HtmlCompress::deflate_data()
+{
+    QTest::addColumn<int>("algorithm");
+    QTest::addColumn<int>("dictionary");
+
+    for (int algorithm = 0; algorithm < Qrypto::Compress::UnknownAlgorithm; ++algorithm)
+        QTest::newRow(Qrypto::Compress::AlgorithmNames.at(algorithm).toLatin1().constData())
+            << algorithm << int(Qrypto::Compress::NoDictionary);
+
+    QTest::newRow("Zstd QtHtmlDictionary") << int(Qrypto::Compress::Zstd) << int(Qrypto::Compress::QtHtmlDictionary);
+}
+
+void tst_HtmlCompress::deflate()
+{
+    QFETCH(int, algorithm);
+    QFETCH(int, dictionary);
+    Qrypto::Compress compress(Qrypto::Compress::Algorithm(algorithm));
+    Qrypto::SequreBytes deflated;
+    compress.setDictionary(dictionary);
+
+    QBENCHMARK {
+        deflated.clear();
+        QCOMPARE(compress.deflate(deflated, m_html), Qrypto::NoError);
+    }
+
+    qDebug("ratio %.3f", double(deflated.size()) / m_html.size());
+}
+
+void tst_HtmlCompress::inflate_data()
+{
+    deflate_data();
+}
+
+void tst_HtmlCompress::inflate()
+{
+    QFETCH(int, algorithm);
+    QFETCH(int, dictionary);
+    Qrypto::Compress compress(Qrypto::Compress::Algorithm(algorithm));
+    Qrypto::SequreBytes deflated;
+    Qrypto::SequreBytes inflated;
+    compress.setDictionary(dictionary);
+    QCOMPARE(compress.deflate(deflated, m_html), Qrypto::NoError);
+
+    QBENCHMARK {
+        inflated.clear();
+        inflated.reserve(m_html.size()); // the Trailer Length is known before inflating
+        QCOMPARE(compress.inflate(inflated, *deflated), Qrypto::NoError);
+    }
+
+    QVERIFY(*inflated == m_html);
+}
+
+QTEST_MAIN(tst_HtmlCompress)
+
+#include "tst_htmlcompress.moc"
@@ -0,0 +1,143 @@
+#include "../../qrypto/qrypticstream.h"
+#include "../../qrypto/qryptocipher.h"
+#include "../../qrypto/qryptocompress.h"
+#include "../../qrypto/qryptokeymaker.h"
+
+#include <QDir>
+#include <QStorageInfo>
+#include <QTemporaryFile>
+#include <QtTest>
+
+namespace
+{
+/// plain data beyond 32-bit sizes, not a multiple of any chunk
+const qint64 PlainSize = (Q_INT64_C(4) << 30) + 65537;
+
+/**
+ * @brief pattern of plain data, repeating within 64 KiB blocks so that it also compresses
+ */
+char pattern(qint64 pos)
+{ return char(pos % 251 + pos / 65536); }
+
+/**
+ * @brief The PatternDevice class generates the pattern when read and verifies it when written,
+ * without keeping any of it
+ */
+class PatternDevice : public QIODevice
+{
+    qint64 m_size;
+    qint64 m_offset;
+    bool m_mismatch;
+
+public:
+    explicit PatternDevice(qint64 size) :
+        m_size(size),
+        m_offset(0),
+        m_mismatch(false)
+    { }
+
+    bool isSequential() const
+    { return true; }
+
+    qint64 bytesAvailable() const
+    { return (openMode() & ReadOnly ? m_size - m_offset : 0) + QIODevice::bytesAvailable(); }
+
+    /**
+     * @brief offset of the next generated or verified byte
+     */
+    qint64 offset() const
+    { return m_offset; }
+
+    bool hasMismatch() const
+    { return m_mismatch; }
+
+protected:
+    qint64 readData(char *data, qint64 maxSize)
+    {
+        const qint64 size = qMin(maxSize, m_size - m_offset);
+
+        for (qint64 i = 0; i < size; ++i)
+            data[i] = pattern(m_offset + i);
+
+        m_offset += size;
+        return size;
+    }
+
+    qint64 writeData(const char *data, qint64 maxSize)
+    {
+        for (qint64 i = 0; i < maxSize && !m_mismatch; ++i)
+            m_mismatch = data[i] != pattern(m_offset + i);
+
+        if (m_mismatch)
+            return -1;
+
+        m_offset += maxSize;
+        return maxSize;
+    }
+};
+}
+
+/**
+ * @brief The tst_LargeFile class round-trips a document beyond 4 GiB through the streaming path
+ */
+class tst_LargeFile : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void roundTrip_data();
+    void roundTrip();
+};
+
+void tst_LargeFile::roundTrip_data()
+{
+    QTest::addColumn<int>("algorithm");
+    QTest::addColumn<bool>("pipelined");
+
+    QTest::newRow("Identity") << int(Qrypto::Compress::Identity) << false; // crypt beyond 4 GiB too
+    QTest::newRow("ZLib pipelined") << int(Qrypto::Compress::ZLib) << true;
+}
+
+void tst_LargeFile::roundTrip()
+{
+    QFETCH(int, algorithm);
+    QFETCH(bool, pipelined);
+    const QString password("password");
+    QTemporaryFile file;
+
+    if (algorithm == Qrypto::Compress::Identity && QStorageInfo(QDir::tempPath()).bytesAvailable() < PlainSize * 5 / 4)
+        QSKIP("not enough temporary storage for the crypt data");
+
+    QVERIFY(file.open());
+
+    {
+        PatternDevice source(PlainSize);
+        QryptIO qryptic(&file);
+        QVERIFY(source.open(QIODevice::ReadOnly));
+        qryptic.setCrypticVersion(3);
+        qryptic.setPipelined(pipelined);
+        qryptic.keyMaker().setIterationCount(1000);
+        qryptic.compress().setAlgorithm(Qrypto::Compress::Algorithm(algorithm));
+        qryptic.compress().setDeflateLevel(1);
+        qryptic.compress().setDeflateTime(0);
+        QCOMPARE(qryptic.encrypt(&source, password), QryptIO::Ok);
+        QCOMPARE(source.offset(), PlainSize);
+    }
+
+    QVERIFY(file.seek(0));
+
+    {
+        PatternDevice sink(PlainSize);
+        QryptIO qryptic(&file);
+        QVERIFY(sink.open(QIODevice::WriteOnly));
+        qryptic.setPipelined(pipelined);
+        QCOMPARE(qryptic.decrypt(&sink, password), QryptIO::Ok);
+        QVERIFY(!sink.hasMismatch());
+        QCOMPARE(sink.offset(), PlainSize);
+        QCOMPARE(qryptic.length(), PlainSize);
+    }
+}
+
+QTEST_GUILESS_MAIN(tst_LargeFile)
+
+#include "tst_largefile.moc"
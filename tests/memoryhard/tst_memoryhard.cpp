@@ -0,0 +1,88 @@
+#include "../../qrypto/qryptomemoryhard.h"
+
+#include <QtTest>
+
+using Qrypto::MemoryHard;
+
+/**
+ * @brief The tst_MemoryHard class checks Argon2id and scrypt against the vectors of their RFCs
+ */
+class tst_MemoryHard : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void argon2id();
+    void scrypt_data();
+    void scrypt();
+};
+
+void tst_MemoryHard::argon2id()
+{
+    // RFC 9106 section 5.3
+    const QByteArray password(32, '\x01');
+    const QByteArray salt(16, '\x02');
+    const QByteArray secret(8, '\x03');
+    const QByteArray data(12, '\x04');
+    QByteArray derived(32, '\0');
+
+    QVERIFY(MemoryHard::argon2id(reinterpret_cast<uchar*>(derived.data()), size_t(derived.size()),
+                                 password.constData(), size_t(password.size()),
+                                 salt.constData(), size_t(salt.size()),
+                                 3, 32, 4,
+                                 secret.constData(), size_t(secret.size()),
+                                 data.constData(), size_t(data.size())));
+    QCOMPARE(derived.toHex(), QByteArray("0d640df58d78766c08c037a34a8b53c9d01ef0452d75b65eb52520e96b01e659"));
+}
+
+void tst_MemoryHard::scrypt_data()
+{
+    QTest::addColumn<QByteArray>("password");
+    QTest::addColumn<QByteArray>("salt");
+    QTest::addColumn<quint64>("cost");
+    QTest::addColumn<uint>("blockSize");
+    QTest::addColumn<uint>("parallelism");
+    QTest::addColumn<QByteArray>("derived");
+
+    // RFC 7914 section 12
+    QTest::newRow("empty") << QByteArray() << QByteArray() << Q_UINT64_C(16) << 1u << 1u
+        << QByteArray("77d6576238657b203b19ca42c18a0497f16b4844e3074ae8dfdffa3fede21442"
+                      "fcd0069ded0948f8326a753a0fc81f17e8d3e0fb2e0d3628cf35e20c38d18906");
+    QTest::newRow("password") << QByteArray("password") << QByteArray("NaCl") << Q_UINT64_C(1024) << 8u << 16u
+        << QByteArray("fdbabe1c9d3472007856e7190d01e9fe7c6ad7cbc8237830e77376634b373162"
+                      "2eaf30d92e22a3886ff109279d9830dac727afb94a83ee6d8360cbdfa2cc0640");
+    QTest::newRow("16 MiB") << QByteArray("pleaseletmein") << QByteArray("SodiumChloride") << Q_UINT64_C(16384) << 8u << 1u
+        << QByteArray("7023bdcb3afd7348461c06cd81fd38ebfda8fbba904f8e3ea9b543f6545da1f2"
+                      "d5432955613f0fcf62d49705242a9af9e61e85dc0d651e40dfcf017b45575887");
+    QTest::newRow("1 GiB") << QByteArray("pleaseletmein") << QByteArray("SodiumChloride") << Q_UINT64_C(1048576) << 8u << 1u
+        << QByteArray("2101cb9b6a511aaeaddbbe09cf70f881ec568d574a2ffd4dabe5ee9820adaa47"
+                      "8e56fd8f4ba5d09ffa1c6d927c40f4c337304049e8a952fbcbf45c6fa77a41a4");
+}
+
+void tst_MemoryHard::scrypt()
+{
+    QFETCH(QByteArray, password);
+    QFETCH(QByteArray, salt);
+    QFETCH(quint64, cost);
+    QFETCH(uint, blockSize);
+    QFETCH(uint, parallelism);
+    QFETCH(QByteArray, derived);
+    QByteArray actual(derived.size() / 2, '\0');
+    bool derivable = false;
+
+    try {
+        derivable = MemoryHard::scrypt(reinterpret_cast<uchar*>(actual.data()), size_t(actual.size()),
+                                       password.constData(), size_t(password.size()),
+                                       salt.constData(), size_t(salt.size()),
+                                       cost, blockSize, parallelism);
+    } catch (const std::bad_alloc &) {
+        QSKIP("not enough lockable memory");
+    }
+
+    QVERIFY(derivable);
+    QCOMPARE(actual.toHex(), derived);
+}
+
+QTEST_GUILESS_MAIN(tst_MemoryHard)
+
+#include "tst_memoryhard.moc"
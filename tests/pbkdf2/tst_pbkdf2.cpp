@@ -0,0 +1,173 @@
+#include "../../qrypto/qryptopbkdf2.h"
+
+#include <QtTest>
+
+using Qrypto::MultiPbkdf2;
+
+namespace
+{
+/**
+ * @brief The Vector struct is a known answer of PBKDF2-HMAC
+ * @note answers beyond RFC 6070 were derived with Python hashlib.pbkdf2_hmac
+ */
+const struct Vector {
+    MultiPbkdf2::Hash hash;
+    const char *password;
+    int passwordSize;
+    int repeat; ///< of the password, beyond the hash block when long
+    const char *salt;
+    int saltSize;
+    uint iterations;
+    const char *derived;
+} Vectors[] = {
+    { MultiPbkdf2::Sha1, "password", 8, 1, "salt", 4, 1,
+      "0c60c80f961f0e71f3a9b524af6012062fe037a6" },
+    { MultiPbkdf2::Sha1, "password", 8, 1, "salt", 4, 2,
+      "ea6c014dc72d6f8ccd1ed92ace1d41f0d8de8957" },
+    { MultiPbkdf2::Sha1, "password", 8, 1, "salt", 4, 4096,
+      "4b007901b765489abead49d926f721d065a429c1" },
+    { MultiPbkdf2::Sha1, "passwordPASSWORDpassword", 24, 1, "saltSALTsaltSALTsaltSALTsaltSALTsalt", 36, 4096,
+      "3d2eec4fe41c849b80c8d83662c0e44a8b291a964cf2f07038" },
+    { MultiPbkdf2::Sha1, "pass\0word", 9, 1, "sa\0lt", 5, 4096,
+      "56fa6aa75548099dcc37d7f03425e0c3" },
+    { MultiPbkdf2::Sha224, "password", 8, 1, "salt", 4, 1,
+      "3c198cbdb9464b7857966bd05b7bc92bc1cc4e6e63155d4e490557fd" },
+    { MultiPbkdf2::Sha224, "password", 8, 1, "salt", 4, 4096,
+      "218c453bf90635bd0a21a75d172703ff6108ef603f65bb821aedade1" },
+    { MultiPbkdf2::Sha224, "passwordPASSWORDpassword", 24, 1, "saltSALTsaltSALTsaltSALTsaltSALTsalt", 36, 100,
+      "2b6123d8884a14651ec81054902e4ce34206acb3f5720d1a35d89642e8c2d376cda88ead0e861b831d2f360a7a912a275aaa87b67b7228a9d71f67fa0a767d41e744345690e376b14ae130f95a97d0" },
+    { MultiPbkdf2::Sha224, "password", 8, 20, "salt", 4, 37,
+      "950d3c46806449dbc0629c4179f4963eb9dedf217da3b8652346589c58f9547e87cf9bfc1c696fb4" },
+    { MultiPbkdf2::Sha224, "", 0, 1, "", 0, 3,
+      "191cf8762867d504c8100f46507395ea33" },
+    { MultiPbkdf2::Sha256, "password", 8, 1, "salt", 4, 1,
+      "120fb6cffcf8b32c43e7225256c4f837a86548c92ccc35480805987cb70be17b" },
+    { MultiPbkdf2::Sha256, "password", 8, 1, "salt", 4, 4096,
+      "c5e478d59288c841aa530db6845c4c8d962893a001ce4e11a4963873aa98134a" },
+    { MultiPbkdf2::Sha256, "passwordPASSWORDpassword", 24, 1, "saltSALTsaltSALTsaltSALTsaltSALTsalt", 36, 100,
+      "642ea3cc424c6e709af485b1e51692f0a7557aa922c0dddc7561830ed30fd4e9205c287a1efebd76cee832d3cb64889e57acd401c681b18c748aa4d8ff7145a0fb838671d46ecc6bc650577720b669ca22843d43fd612fb0455b33" },
+    { MultiPbkdf2::Sha256, "password", 8, 20, "salt", 4, 37,
+      "84b006244c483c7027a2283dd77f58eefe28c396f7e1d576adf0d632e4e313c107b095ef1ff87f2e" },
+    { MultiPbkdf2::Sha256, "", 0, 1, "", 0, 3,
+      "b372796454d37ac042a195b62eeb7cfed3" },
+    { MultiPbkdf2::Sha384, "password", 8, 1, "salt", 4, 1,
+      "c0e14f06e49e32d73f9f52ddf1d0c5c7191609233631dadd76a567db42b78676b38fc800cc53ddb642f5c74442e62be4" },
+    { MultiPbkdf2::Sha384, "password", 8, 1, "salt", 4, 4096,
+      "559726be38db125bc85ed7895f6e3cf574c7a01c080c3447db1e8a76764deb3c307b94853fbe424f6488c5f4f1289626" },
+    { MultiPbkdf2::Sha384, "passwordPASSWORDpassword", 24, 1, "saltSALTsaltSALTsaltSALTsaltSALTsalt", 36, 100,
+      "0075d57842e830f44817821aba8dc486ae32b89b6a31902840aae942b21d3681a971330810f088b454b4d78307d164cde841f03fc2a4c2865475cb6da7e2c6848d3f404da2276a38ab5dea7b882c990c75a2a05c42221797009858ebbfb97a4871ab1836a2afe5d9d724b215458ac66901ab0d968cefe89bf338039c8e39cafe8f0f66501101ed1a71e6c0" },
+    { MultiPbkdf2::Sha384, "password", 8, 20, "salt", 4, 37,
+      "111cba5394b79ba3d17826be4d1b2abfe1088606f45af57ce02dbf167f944417f16fd52a0231b447" },
+    { MultiPbkdf2::Sha384, "", 0, 1, "", 0, 3,
+      "c3a702cb4faaabd111e2b64fd7851aa278" },
+    { MultiPbkdf2::Sha512, "password", 8, 1, "salt", 4, 1,
+      "867f70cf1ade02cff3752599a3a53dc4af34c7a669815ae5d513554e1c8cf252c02d470a285a0501bad999bfe943c08f050235d7d68b1da55e63f73b60a57fce" },
+    { MultiPbkdf2::Sha512, "password", 8, 1, "salt", 4, 4096,
+      "d197b1b33db0143e018b12f3d1d1479e6cdebdcc97c5c0f87f6902e072f457b5143f30602641b3d55cd335988cb36b84376060ecd532e039b742a239434af2d5" },
+    { MultiPbkdf2::Sha512, "passwordPASSWORDpassword", 24, 1, "saltSALTsaltSALTsaltSALTsaltSALTsalt", 36, 100,
+      "eadc4d79ba411a9a482f12908081c724b9e8189b29270968541ce9bf0620d5fa58ed6b8d6702990fb7530ec6e1c16b5c2b8e648596c69b8f7fd5c14050b0574da50b26b54b8f56eb04cc73e397057d2641b3eaec3096f04e2348567259a08df740ac6199ebfefb71d85101a8aa92083743a6596f778562dc9b0dd45d78888e28a830e94a972e589a444bf0b5b920306a1ea40ec62d98c87d354d39fe271844684dc227c0d436102c55d78e7b8ec9cad69ad571bc574eec7817b382" },
+    { MultiPbkdf2::Sha512, "password", 8, 20, "salt", 4, 37,
+      "01b7d3863c0128d1777ad04e013821afa340ee7a6fb867a219f81ce77c50dcc25b704f90f9cb4f5c" },
+    { MultiPbkdf2::Sha512, "", 0, 1, "", 0, 3,
+      "ba78a2c18fe1f3cfffaba0f93ccf85fc34" },
+    { MultiPbkdf2::Sha1, "password", 8, 9, "NaCl", 4, 513,
+      "40382623ddf8fd50de96bf24e46288f8ce8c23ab01868840f3c7abe209c935384c0b402cddf84763208469e8b04c1adc756a7ddbd4b7f5a6028978a0054c864f" }
+};
+
+const int VectorCount = int(sizeof Vectors / sizeof Vectors[0]);
+}
+
+/**
+ * @brief The tst_Pbkdf2 class checks MultiPbkdf2 against known answers at each level of instructions
+ */
+class tst_Pbkdf2 : public QObject
+{
+    Q_OBJECT
+
+    QList<QByteArray> m_passwords;
+    QList<QByteArray> m_derived;
+
+    MultiPbkdf2::Job job(int vector);
+
+private slots:
+    void initTestCase();
+    void single_data();
+    void single();
+    void batch_data();
+    void batch();
+};
+
+MultiPbkdf2::Job tst_Pbkdf2::job(int vector)
+{
+    const Vector &v = Vectors[vector];
+    MultiPbkdf2::Job job;
+    m_derived[vector].fill('\0');
+    job.hash = v.hash;
+    job.password = m_passwords.at(vector).constData();
+    job.passwordSize = size_t(m_passwords.at(vector).size());
+    job.salt = v.salt;
+    job.saltSize = size_t(v.saltSize);
+    job.iterations = v.iterations;
+    job.derived = reinterpret_cast<uchar*>(m_derived[vector].data());
+    job.derivedSize = size_t(m_derived.at(vector).size());
+    return job;
+}
+
+void tst_Pbkdf2::initTestCase()
+{
+    for (int vector = 0; vector < VectorCount; ++vector) {
+        const Vector &v = Vectors[vector];
+        m_passwords << QByteArray(v.password, v.passwordSize).repeated(v.repeat);
+        m_derived << QByteArray(int(qstrlen(v.derived)) / 2, '\0');
+    }
+}
+
+void tst_Pbkdf2::single_data()
+{
+    QTest::addColumn<int>("level");
+
+    QTest::newRow("Portable") << int(MultiPbkdf2::Portable);
+    QTest::newRow("Avx2") << int(MultiPbkdf2::Avx2);
+    QTest::newRow("Avx512") << int(MultiPbkdf2::Avx512);
+}
+
+void tst_Pbkdf2::single()
+{
+    QFETCH(int, level);
+
+    if (level > MultiPbkdf2::level())
+        QSKIP("not supported by this processor");
+
+    for (int vector = 0; vector < VectorCount; ++vector) {
+        const MultiPbkdf2::Job single = job(vector);
+        MultiPbkdf2::derive(&single, 1, MultiPbkdf2::Level(level));
+        QCOMPARE(m_derived.at(vector).toHex(), QByteArray(Vectors[vector].derived));
+    }
+}
+
+void tst_Pbkdf2::batch_data()
+{
+    single_data();
+}
+
+void tst_Pbkdf2::batch()
+{
+    QFETCH(int, level);
+    QVector<MultiPbkdf2::Job> jobs;
+
+    if (level > MultiPbkdf2::level())
+        QSKIP("not supported by this processor");
+
+    for (int vector = 0; vector < VectorCount; ++vector)
+        jobs << job(vector);
+
+    // chains of all lanes end at different iterations, so lanes are refilled on the way
+    MultiPbkdf2::derive(jobs.constData(), jobs.size(), MultiPbkdf2::Level(level));
+
+    for (int vector = 0; vector < VectorCount; ++vector)
+        QCOMPARE(m_derived.at(vector).toHex(), QByteArray(Vectors[vector].derived));
+}
+
+QTEST_GUILESS_MAIN(tst_Pbkdf2)
+
+#include "tst_pbkdf2.moc"
@@ -0,0 +1,58 @@
+#include "../../qrypto/qrypto.h"
+#include "../../qrypto/sequre.h"
+
+#include <QtTest>
+
+#include <cryptopp/filters.h>
+
+namespace
+{
+typedef CryptoPP::StringSinkTemplate<Qrypto::SequreBytes> SequreSink;
+
+/// bytes put at once, as a filter passes its output on
+const int PieceSize = 4096;
+}
+
+/**
+ * @brief The tst_SequreSink class benchmarks appending piece by piece into SequreBytes
+ * through a Crypto++ sink, which is linear only while Sequre grows geometrically
+ */
+class tst_SequreSink : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void append_data();
+    void append();
+};
+
+void tst_SequreSink::append_data()
+{
+    QTest::addColumn<int>("size");
+
+    QTest::newRow("8 MiB") << (8 << 20);
+    QTest::newRow("32 MiB") << (32 << 20);
+    QTest::newRow("64 MiB") << (64 << 20);
+    QTest::newRow("128 MiB") << (128 << 20);
+    QTest::newRow("256 MiB") << (256 << 20);
+}
+
+void tst_SequreSink::append()
+{
+    QFETCH(int, size);
+    const QByteArray piece(PieceSize, 'x');
+
+    QBENCHMARK {
+        Qrypto::SequreBytes bytes;
+        SequreSink sink(bytes);
+
+        for (int offset = 0; offset < size; offset += PieceSize)
+            sink.Put(reinterpret_cast<const CryptoPP::byte*>(piece.constData()), PieceSize);
+
+        QCOMPARE(bytes.size(), size);
+    }
+}
+
+QTEST_GUILESS_MAIN(tst_SequreSink)
+
+#include "tst_sequresink.moc"
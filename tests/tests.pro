@@ -0,0 +1,9 @@
+TEMPLATE = subdirs
+
+SUBDIRS += handoff \
+    encoding \
+    htmlcompress \
+    largefile \
+    memoryhard \
+    pbkdf2 \
+    sequresink